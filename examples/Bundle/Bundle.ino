@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+//
+// Shows how to serve files embedded in the firmware, without any file system.
+//
+// webbundle.h is generated from the data folder with:
+//
+// python3 tools/webbundle.py examples/Bundle/data examples/Bundle/webbundle.h --cache-control no-cache
+//
+// or at each build with PlatformIO, see tools/webbundle.py
+//
+
+#include <Arduino.h>
+#if defined(ESP32) || defined(LIBRETINY)
+#include <AsyncTCP.h>
+#include <WiFi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#elif defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350)
+#include <RPAsyncTCP.h>
+#include <WiFi.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+
+#include "webbundle.h"
+
+static AsyncWebServer server(80);
+
+void setup() {
+  Serial.begin(115200);
+
+#if SOC_WIFI_SUPPORTED || CONFIG_ESP_WIFI_REMOTE_ENABLED || LT_ARD_HAS_WIFI
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP("esp-captive");
+#endif
+
+  // curl -v --compressed http://192.168.4.1/
+  // curl -v http://192.168.4.1/style.css
+  // curl -v -H 'If-None-Match: "ac7fc821"' http://192.168.4.1/style.css => 304
+  server.serveBundle("/", webBundle);
+
+  // content types can be added for the file responses
+  AsyncMimeTypes::Instance().add(".wasm", "application/wasm");
+
+  server.begin();
+}
+
+// not needed
+void loop() {
+  delay(100);
+}
@@ -0,0 +1,39 @@
+// Generated by tools/webbundle.py from data, do not edit
+#pragma once
+
+#include <ESPAsyncWebServer.h>
+
+// /index.html (220 bytes, gzip)
+static const uint8_t webBundle_0[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x55, 0x50, 0x31, 0x4e, 0xc4, 0x30, 0x10, 0xec, 0xef, 0x15,
+  0x7b, 0xe9, 0x49, 0x74, 0x1d, 0x85, 0x2f, 0x05, 0x70, 0x12, 0x1d, 0x14, 0xd7, 0x50, 0xda, 0xe7, 0x09, 0xb6, 0x58, 0xc7,
+  0x91, 0xbd, 0x21, 0xf2, 0xef, 0xf1, 0x39, 0x50, 0x50, 0x8d, 0x76, 0x76, 0x66, 0x67, 0xb4, 0xea, 0xf8, 0xf2, 0xf6, 0x7c,
+  0xfd, 0x78, 0xbf, 0x90, 0x93, 0xc0, 0xe3, 0x41, 0xfd, 0x01, 0xb4, 0x1d, 0x0f, 0x44, 0x2a, 0x40, 0x34, 0xdd, 0x9c, 0x4e,
+  0x19, 0x72, 0xee, 0x56, 0x99, 0x1e, 0x1e, 0xbb, 0xb6, 0x10, 0x2f, 0x8c, 0xf1, 0x69, 0x9d, 0x2d, 0x43, 0x0d, 0xfb, 0x74,
+  0xe7, 0xd9, 0xcf, 0x5f, 0x94, 0xc0, 0xe7, 0x2e, 0x4b, 0x61, 0x64, 0x07, 0x48, 0x47, 0x2e, 0x61, 0xfa, 0x65, 0xfa, 0x5b,
+  0xce, 0xf5, 0x84, 0x1a, 0xf6, 0x0c, 0x65, 0xa2, 0x2d, 0xcd, 0xe9, 0x4e, 0xe3, 0x2b, 0x98, 0x23, 0x4d, 0x29, 0x06, 0x12,
+  0x07, 0x9a, 0x7c, 0x0a, 0x9b, 0x4e, 0x38, 0x56, 0xf1, 0xa9, 0x69, 0x96, 0xf1, 0xea, 0x7c, 0xa6, 0x45, 0x7f, 0x82, 0x2a,
+  0x22, 0x18, 0x58, 0x0b, 0x4b, 0x7e, 0xfe, 0x67, 0x20, 0x53, 0x48, 0x62, 0xe4, 0x3c, 0x6c, 0x30, 0xa6, 0x75, 0xec, 0x97,
+  0x42, 0x7a, 0xb6, 0x94, 0x91, 0xbe, 0xab, 0x61, 0xf3, 0xe2, 0xe2, 0x2a, 0x95, 0x2a, 0xd5, 0xc5, 0xa0, 0x5c, 0xb2, 0x20,
+  0xf4, 0x6a, 0x58, 0xee, 0xdd, 0xf6, 0x52, 0x35, 0xb6, 0xbd, 0xe3, 0x07, 0x2b, 0x6a, 0xc0, 0x63, 0x26, 0x01, 0x00, 0x00,
+};
+
+// /style.css (121 bytes)
+static const uint8_t webBundle_1[] PROGMEM = {
+  0x62, 0x6f, 0x64, 0x79, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x66, 0x6f, 0x6e, 0x74, 0x2d, 0x66, 0x61, 0x6d, 0x69, 0x6c, 0x79,
+  0x3a, 0x20, 0x73, 0x61, 0x6e, 0x73, 0x2d, 0x73, 0x65, 0x72, 0x69, 0x66, 0x3b, 0x0a, 0x20, 0x20, 0x6d, 0x61, 0x72, 0x67,
+  0x69, 0x6e, 0x3a, 0x20, 0x32, 0x65, 0x6d, 0x3b, 0x0a, 0x20, 0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x33,
+  0x33, 0x33, 0x3b, 0x0a, 0x20, 0x20, 0x62, 0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64, 0x2d, 0x63, 0x6f, 0x6c,
+  0x6f, 0x72, 0x3a, 0x20, 0x23, 0x66, 0x61, 0x66, 0x61, 0x66, 0x61, 0x3b, 0x0a, 0x7d, 0x0a, 0x0a, 0x68, 0x31, 0x20, 0x7b,
+  0x0a, 0x20, 0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x30, 0x30, 0x36, 0x36, 0x63, 0x63, 0x3b, 0x0a, 0x7d,
+  0x0a,
+};
+
+static const AsyncBundleAsset webBundle_assets[] = {
+  {"/index.html", webBundle_0, 220, "\"73529ef4\"", "text/html", "gzip", "no-cache"},
+  {"/style.css", webBundle_1, 121, "\"ac7fc821\"", "text/css", nullptr, "no-cache"},
+};
+
+static const uint16_t webBundle_table[] = {2, 1};
+
+static const AsyncBundle webBundle = {webBundle_assets, 2, webBundle_table, 2, 0x811c9dc5UL};
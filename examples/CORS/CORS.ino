@@ -30,7 +30,11 @@ void setup() {
   WiFi.softAP("esp-captive");
 #endif
 
+  // a single origin for all the requests...
   cors.setOrigin("http://192.168.4.1");
+  // ...or an allow-list: each allowed origin gets its own origin in access-control-allow-origin
+  // cors.addOrigin("http://192.168.4.1");
+  // cors.addOrigin("http://esp-captive.local");
   cors.setMethods("POST, GET, OPTIONS, DELETE");
   cors.setHeaders("X-Custom-Header");
   cors.setAllowCredentials(false);
@@ -38,7 +42,7 @@ void setup() {
 
   server.addMiddleware(&cors);
 
-  // Test CORS preflight request
+  // Test CORS preflight request (answered with 204 No Content, or 403 Forbidden for an origin not in the allow-list)
   // curl -v -X OPTIONS -H "origin: http://192.168.4.1" http://192.168.4.1/cors
   //
   // Test CORS request
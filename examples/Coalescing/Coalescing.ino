@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+//
+// Shows how to answer identical concurrent requests with one response: the handler builds it only once
+//
+
+#include <Arduino.h>
+#if defined(ESP32) || defined(LIBRETINY)
+#include <AsyncTCP.h>
+#include <WiFi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#elif defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350)
+#include <RPAsyncTCP.h>
+#include <WiFi.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+
+static AsyncWebServer server(80);
+static AsyncCoalesceMiddleware coalesce;
+
+// this server does not store the cookies: its requests cannot be coalesced since their cookies cannot be compared
+static AsyncWebServer noCookieServer(8080);
+static AsyncCoalesceMiddleware noCookieCoalesce;
+
+// requests whose response is being built (here: waiting 1 second)
+static std::vector<AsyncWebServerRequestPtr> statusRequests;
+static uint32_t statusSince = 0;
+static uint32_t computations = 0;
+
+static void handleStatus(AsyncWebServerRequest *request) {
+  statusRequests.push_back(request->pause());
+  if (!statusSince) {
+    statusSince = millis();
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+#if SOC_WIFI_SUPPORTED || CONFIG_ESP_WIFI_REMOTE_ENABLED || LT_ARD_HAS_WIFI
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP("esp-captive");
+#endif
+
+  server.addMiddleware(&coalesce);
+
+  // the response takes 1 second to build: the requests arriving meanwhile wait for it instead of building their own,
+  // so they all get the same "computations" value
+  //
+  // for i in $(seq 1 10); do curl -s http://192.168.4.1/status & done; wait
+  //
+  server.on("/status", HTTP_GET, handleStatus);
+
+  // the same requests sent to this server all build their own response: each one gets a different "computations" value
+  //
+  // for i in $(seq 1 10); do curl -s http://192.168.4.1:8080/status & done; wait
+  //
+  noCookieServer.dropHeader("Cookie");
+  noCookieServer.addMiddleware(&noCookieCoalesce);
+  noCookieServer.on("/status", HTTP_GET, handleStatus);
+
+  server.begin();
+  noCookieServer.begin();
+}
+
+void loop() {
+  if (statusSince && millis() - statusSince >= 1000) {
+    statusSince = 0;
+    // a waiting request taking over (the client disconnected in the meantime) pauses again: answer the current ones only
+    std::vector<AsyncWebServerRequestPtr> requests;
+    requests.swap(statusRequests);
+    for (AsyncWebServerRequestPtr &requestPtr : requests) {
+      std::shared_ptr<AsyncWebServerRequest> request = requestPtr.lock();
+      if (request) {
+        request->send(200, "application/json", "{\"computations\":" + String(++computations) + "}");
+      }
+    }
+  }
+  delay(100);
+}
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+//
+// Show how to answer conditional GET requests (If-None-Match) with 304 Not Modified
+//
+
+#include <Arduino.h>
+#if defined(ESP32) || defined(LIBRETINY)
+#include <AsyncTCP.h>
+#include <WiFi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#elif defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350)
+#include <RPAsyncTCP.h>
+#include <WiFi.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+
+static AsyncWebServer server(80);
+static AsyncETagMiddleware etag;
+static AsyncETagMiddleware versionedETag;
+
+static uint32_t configRevision = 1;
+
+void setup() {
+  Serial.begin(115200);
+
+#if SOC_WIFI_SUPPORTED || CONFIG_ESP_WIFI_REMOTE_ENABLED || LT_ARD_HAS_WIFI
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP("esp-captive");
+#endif
+
+  // the ETag is computed from the content of the response:
+  //
+  // curl -v http://192.168.4.1/
+  // curl -v -H 'If-None-Match: "<etag>"' http://192.168.4.1/
+  //
+  server
+    .on(
+      "/", HTTP_GET,
+      [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain", "Hello, world!");
+      }
+    )
+    .addMiddleware(&etag);
+
+  // the ETag is the configuration revision: the handler is not called if the client is up to date
+  //
+  // curl -v http://192.168.4.1/config
+  // curl -v -H 'If-None-Match: "1"' http://192.168.4.1/config
+  // curl -v -X POST http://192.168.4.1/config
+  //
+  versionedETag.setVersion([](AsyncWebServerRequest *request) {
+    return String(configRevision);
+  });
+
+  server
+    .on(
+      "/config", HTTP_GET,
+      [](AsyncWebServerRequest *request) {
+        AsyncResponseStream *response = request->beginResponseStream("text/plain");
+        response->printf("revision: %" PRIu32 "\n", configRevision);
+        request->send(response);
+      }
+    )
+    .addMiddleware(&versionedETag);
+
+  server.on("/config", HTTP_POST, [](AsyncWebServerRequest *request) {
+    configRevision++;
+    request->send(200, "text/plain", "OK");
+  });
+
+  server.begin();
+}
+
+// not needed
+void loop() {
+  delay(100);
+}
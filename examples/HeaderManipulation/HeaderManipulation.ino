@@ -48,6 +48,10 @@ void setup() {
 
   server.addMiddlewares({&requestLogger, &headerFilter});
 
+  // the cookies are never stored in the requests: they are skipped by the parser.
+  // server.keepHeader(name) would instead store only the kept headers (and the ones the server needs)
+  server.dropHeader("Cookie");
+
   // x-remove-me header will be removed
   //
   // curl -v -H "X-Header: Foo" -H "x-remove-me: value" http://192.168.4.1/remove
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+//
+// Shows how to refuse the requests at once when the device is saturated, instead of letting all of them time out
+//
+
+#include <Arduino.h>
+#if defined(ESP32) || defined(LIBRETINY)
+#include <AsyncTCP.h>
+#include <WiFi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#elif defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350)
+#include <RPAsyncTCP.h>
+#include <WiFi.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+
+static AsyncWebServer server(80);
+static AsyncConcurrencyLimitMiddleware limiter;
+
+void setup() {
+  Serial.begin(115200);
+
+#if SOC_WIFI_SUPPORTED || CONFIG_ESP_WIFI_REMOTE_ENABLED || LT_ARD_HAS_WIFI
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP("esp-captive");
+#endif
+
+  // 2 to 8 requests served at the same time, the limit decreasing when they take more than 200 ms
+  limiter.setLimits(2, 8);
+  limiter.setTargetLatency(200);
+  limiter.setRetryAfter(2);
+  // the health checks and the admin pages are always served
+  limiter.setBypass([](AsyncWebServerRequest *request) {
+    return request->url() == "/health" || request->url().startsWith("/admin/");
+  });
+
+  server.addMiddleware(&limiter);
+
+  // a slow handler: under load, the limit goes down and the extra requests get a 503 with Retry-After
+  //
+  // for i in $(seq 1 20); do curl -s -o /dev/null -w "%{http_code}\n" http://192.168.4.1/slow & done; wait
+  //
+  server.on("/slow", HTTP_GET, [](AsyncWebServerRequest *request) {
+    delay(300);
+    request->send(200, "text/plain", "Done");
+  });
+
+  // curl -v http://192.168.4.1/health
+  server.on("/health", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", "limit: " + String(limiter.limit()) + ", in flight: " + String(limiter.inFlight()) + ", refused: " + String(limiter.refused()));
+  });
+
+  server.begin();
+}
+
+// not needed
+void loop() {
+  delay(100);
+}
@@ -21,13 +21,22 @@
 
 static AsyncWebServer server(80);
 
+// request paused by a middleware, and the rest of its chain to run later
+static AsyncWebServerRequestPtr pausedRequest;
+static ArMiddlewareNext pausedNext;
+static uint32_t pausedSince = 0;
+
 // New middleware classes can be created!
 class MyMiddleware : public AsyncMiddleware {
 public:
   void run(AsyncWebServerRequest *request, ArMiddlewareNext next) override {
     Serial.printf("Before handler: %s %s\n", request->methodToString(), request->url().c_str());
     next();  // continue middleware chain
-    Serial.printf("After handler: response code=%d\n", request->getResponse()->code());
+    if (request->getResponse()) {
+      Serial.printf("After handler: response code=%d\n", request->getResponse()->code());
+    } else {
+      Serial.println("After handler: no response yet (request paused)");
+    }
   }
 };
 
@@ -73,10 +82,35 @@ void setup() {
     }
   });
 
+  // a middleware can also continue the chain later: it pauses the request and calls next() from somewhere else
+  // (here from loop() after 1 second), the handler then runs and its response is sent
+  //
+  // - curl -v http://192.168.4.1/slow  => 200 OK after 1 second
+  //
+  AsyncCallbackWebHandler &slow = server.on("/slow", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", "Hello, later!");
+  });
+  slow.addMiddleware([](AsyncWebServerRequest *request, ArMiddlewareNext next) {
+    if (auto paused = pausedRequest.lock()) {
+      request->send(503, "text/plain", "Busy");
+      return;
+    }
+    pausedRequest = request->pause();
+    pausedNext = next;
+    pausedSince = millis();
+  });
+
   server.begin();
 }
 
-// not needed
 void loop() {
+  if (pausedNext && millis() - pausedSince >= 1000) {
+    // the client may have disconnected in the meantime
+    if (auto request = pausedRequest.lock()) {
+      pausedNext();
+    }
+    pausedNext = nullptr;
+    pausedRequest.reset();
+  }
   delay(100);
 }
@@ -113,6 +113,14 @@ void setup() {
     request->send(200, "text/plain", "Hello " + who + "!");
   });
 
+  // Get path parameters
+  //
+  // curl -v http://192.168.4.1/devices/kitchen/sensors/2
+  //
+  server.on("/devices/{id}/sensors/{sensor:int}", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", "Device " + request->pathArg("id") + ", sensor " + request->pathArg(1));
+  });
+
   server.begin();
 }
 
@@ -57,6 +57,9 @@ void setup() {
   // Add "&raw=false" parameter to download the partition unencrypted (for encrypted partitions).
   // By default, the raw partition is downloaded, so if a partition is encrypted, the encrypted data will be downloaded.
   //
+  // When possible, the partition is memory-mapped and sent without any copy, with support for range requests:
+  // > curl -r 0-4095 "http://192.168.4.1/partition?label=spiffs" -o first-block.bin
+  //
   // To browse a downloaded LittleFS partition, you can use https://tniessen.github.io/littlefs-disk-img-viewer/ (block size is 4096)
   //
   server.on("/partition", HTTP_GET, [](AsyncWebServerRequest *request) {
@@ -98,6 +101,16 @@ void setup() {
       return;
     }
 
+    const String filename = String(partition->label) + ".bin";
+
+    // the mapped content is decrypted by the flash cache, so it is only the raw content if the partition is not encrypted
+    AsyncMappedRegion region;
+    if ((!raw || !partition->encrypted) && AsyncMappedResponse::mapPartition(partition, region)) {
+      request->send(new AsyncMappedResponse(region, filename, "application/octet-stream", true));
+      return;
+    }
+
+    // not enough free MMU pages to map the partition: read it by chunks
     AsyncWebServerResponse *response =
       request->beginChunkedResponse("application/octet-stream", [partition, raw](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
         const size_t remaining = partition->size - index;
@@ -114,7 +127,7 @@ void setup() {
         return 0;
       });
 
-    response->addHeader("Content-Disposition", "attachment; filename=" + String(partition->label) + ".bin");
+    response->addHeader("Content-Disposition", "attachment; filename=" + filename);
     response->setContentLength(partition->size);
 
     request->send(response);
@@ -30,9 +30,11 @@ void setup() {
   WiFi.softAP("esp-captive");
 #endif
 
-  // maximum 5 requests per 10 seconds
+  // maximum 5 requests per 10 seconds and per client (IP address): a burst of 5 requests, then 1 more every 2 seconds
   rateLimit.setMaxRequests(5);
   rateLimit.setWindowSize(10);
+  // up to 32 clients tracked at the same time
+  rateLimit.setMaxClients(32);
 
   // run quickly several times:
   //
@@ -42,7 +44,7 @@ void setup() {
     request->send(200, "text/plain", "Hello, world!");
   });
 
-  // run quickly several times:
+  // run quickly several times, the RateLimit-Remaining header goes down to 0, then 429 Too Many Requests with Retry-After:
   //
   // curl -v http://192.168.4.1/rate-limited
   //
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+//
+// Shows how to cache the responses which are expensive to build but stay valid for a few seconds
+//
+
+#include <Arduino.h>
+#if defined(ESP32) || defined(LIBRETINY)
+#include <AsyncTCP.h>
+#include <WiFi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#elif defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350)
+#include <RPAsyncTCP.h>
+#include <WiFi.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+
+static AsyncWebServer server(80);
+static AsyncCacheMiddleware cache;
+
+static uint32_t computations = 0;
+
+void setup() {
+  Serial.begin(115200);
+
+#if SOC_WIFI_SUPPORTED || CONFIG_ESP_WIFI_REMOTE_ENABLED || LT_ARD_HAS_WIFI
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP("esp-captive");
+#endif
+
+  // 16 KB of cached responses at most, kept 10 seconds, 2 seconds for the sensors and never for the status
+  cache.setMaxBytes(16 * 1024);
+  cache.setTTL(10);
+  cache.setTTL("/sensors", 2);
+  cache.setTTL("/status", 0);
+
+  server.addMiddleware(&cache);
+
+  // the handler is only called when the cached response expired: "computations" only changes every 2 seconds
+  //
+  // curl -v http://192.168.4.1/sensors
+  // curl -v http://192.168.4.1/sensors?id=2
+  //
+  server.on("/sensors", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->printf("{\"id\":\"%s\",\"value\":%lu,\"computations\":%lu}", request->arg("id").c_str(), (unsigned long)random(1000), (unsigned long)++computations);
+    request->send(response);
+  });
+
+  // never cached
+  //
+  // curl -v http://192.168.4.1/status
+  //
+  server.on("/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", String(millis()));
+  });
+
+  // the response is not cached, because of its cache-control header
+  //
+  // curl -v http://192.168.4.1/private
+  //
+  server.on("/private", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncWebServerResponse *response = request->beginResponse(200, "text/plain", "Hello, you!");
+    response->addHeader("Cache-Control", "private");
+    request->send(response);
+  });
+
+  // empties the cache, i.e. after a configuration change
+  //
+  // curl -v -X POST http://192.168.4.1/clear
+  //
+  server.on("/clear", HTTP_POST, [](AsyncWebServerRequest *request) {
+    cache.clear();
+    request->send(204);
+  });
+
+  server.begin();
+}
+
+void loop() {
+  delay(100);
+}
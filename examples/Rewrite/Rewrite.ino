@@ -43,6 +43,9 @@ void setup() {
   server.rewrite("/", "/index.html");
   server.rewrite("/index.txt", "/index.html");  // will hide the .txt file
 
+  // curl -v http://192.168.4.1/old/page.html
+  server.rewrite("/old/*", "/index.html");  // all the URLs starting with /old/
+
   server.begin();
 }
 
@@ -135,6 +135,25 @@ void setup() {
   // curl -v http://192.168.4.1/base/b.txt => serves b.txt
   server.serveStatic("/base", LittleFS, "/files").setDefaultFile("a.txt");
 
+  // Example to cache the file lookups (up to 16 URLs, for 1 minute) to avoid the file system calls
+  // curl -v http://192.168.4.1/cached/a.txt
+  // curl -v http://192.168.4.1/cached/missing.txt => 404 without touching the file system the second time
+  server.serveStatic("/cached", LittleFS, "/files").setCache(16, 60000);
+
+  // Example to keep the content of the small files (up to 8 KB each, 32 KB total) in memory
+  // curl -v http://192.168.4.1/memory/a.txt
+  server.serveStatic("/memory", LittleFS, "/files").setMemoryCache(32 * 1024, 8 * 1024);
+
+  // Example to read the files in a background task, 2 blocks of 4 KB ahead (ESP32 only, useful with slow storage like SD cards)
+  // curl -v http://192.168.4.1/readahead/a.txt
+  server.serveStatic("/readahead", LittleFS, "/files").setReadAhead(4096, 2);
+
+  // Example to index the files at startup: missing files are answered without any file system call
+  // curl -v http://192.168.4.1/indexed/a.txt
+  // curl -v http://192.168.4.1/indexed/missing.txt
+  AsyncStaticWebHandler &indexed = server.serveStatic("/indexed", LittleFS, "/files").setIndexed(true, 4096);
+  Serial.printf("Indexed %u files in %u bytes\n", indexed.indexSize(), indexed.indexFootprint());
+
   server.begin();
 }
 
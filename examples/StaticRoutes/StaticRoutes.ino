@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+//
+// Shows how to declare the routes at compile time: one handler, no allocation to find the route of a request
+//
+
+#include <Arduino.h>
+#if defined(ESP32) || defined(LIBRETINY)
+#include <AsyncTCP.h>
+#include <WiFi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#elif defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350)
+#include <RPAsyncTCP.h>
+#include <WiFi.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+
+// AsyncRoutes.h requires C++17 (Arduino-ESP32 2.x builds with C++11)
+#if __cplusplus >= 201703L
+#include <AsyncRoutes.h>
+
+static AsyncWebServer server(80);
+
+static int counter = 0;
+
+static void handleRoot(AsyncWebServerRequest *request) {
+  request->send(200, "text/html", "<h1>Hello, world!</h1>");
+}
+
+static void getCounter(AsyncWebServerRequest *request) {
+  request->send(200, "text/plain", String(counter));
+}
+
+static void setCounter(AsyncWebServerRequest *request) {
+  if (!request->hasParam("value", true)) {
+    request->send(400, "text/plain", "Missing value");
+    return;
+  }
+  counter = request->getParam("value", true)->value().toInt();
+  request->send(200, "text/plain", String(counter));
+}
+
+static void noContent(AsyncWebServerRequest *request) {
+  request->send(204);
+}
+
+// with C++20, the paths can also be given directly: AsyncGet<"/", handleRoot>
+static constexpr char rootPath[] = "/";
+static constexpr char counterPath[] = "/api/counter";
+static constexpr char androidProbePath[] = "/generate_204";
+
+// the table of the routes (and its perfect hash) is computed by the compiler
+using Routes = AsyncRoutes<
+  AsyncGet<rootPath, handleRoot>, AsyncGet<counterPath, getCounter>, AsyncPost<counterPath, setCounter>, AsyncGet<androidProbePath, noContent>>;
+
+void setup() {
+  Serial.begin(115200);
+
+#if SOC_WIFI_SUPPORTED || CONFIG_ESP_WIFI_REMOTE_ENABLED || LT_ARD_HAS_WIFI
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP("esp-captive");
+#endif
+
+  // curl -v http://192.168.4.1/
+  // curl -v http://192.168.4.1/api/counter
+  // curl -v -X POST -d "value=42" http://192.168.4.1/api/counter
+  // curl -v http://192.168.4.1/generate_204
+  server.addHandler(new Routes());
+
+  server.onNotFound([](AsyncWebServerRequest *request) {
+    request->send(404, "text/plain", "Not found");
+  });
+
+  server.begin();
+}
+
+// not needed
+void loop() {
+  delay(100);
+}
+
+#else
+void setup() {}
+void loop() {}
+#endif
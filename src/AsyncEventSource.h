@@ -306,6 +306,9 @@ public:
   void _addClient(AsyncEventSourceClient *client);
   void _handleDisconnect(AsyncEventSourceClient *client);
   bool canHandle(AsyncWebServerRequest *request) const override final;
+  AsyncWebRoute route() const override final {
+    return AsyncWebRoute(ROUTE_EXACT, _url.c_str(), _url.length(), HTTP_ANY);
+  }
   void handleRequest(AsyncWebServerRequest *request) override final;
 };
 
@@ -59,6 +59,32 @@ size_t AsyncJsonResponse::_fillBuffer(uint8_t *data, size_t len) {
   return len;
 }
 
+bool AsyncJsonResponse::_contentHash(uint32_t &hash) {
+  if (!_isValid) {
+    return false;
+  }
+  HashPrint dest;
+#if ARDUINOJSON_VERSION_MAJOR == 5
+  _root.printTo(dest);
+#else
+  serializeJson(_root, dest);
+#endif
+  hash = dest.hash();
+  return true;
+}
+
+bool AsyncJsonResponse::_contentPrint(Print &out) {
+  if (!_isValid) {
+    return false;
+  }
+#if ARDUINOJSON_VERSION_MAJOR == 5
+  _root.printTo(out);
+#else
+  serializeJson(_root, out);
+#endif
+  return true;
+}
+
 #if ARDUINOJSON_VERSION_MAJOR == 6
 PrettyAsyncJsonResponse::PrettyAsyncJsonResponse(bool isArray, size_t maxJsonBufferSize) : AsyncJsonResponse{isArray, maxJsonBufferSize} {}
 #else
@@ -87,6 +113,32 @@ size_t PrettyAsyncJsonResponse::_fillBuffer(uint8_t *data, size_t len) {
   return len;
 }
 
+bool PrettyAsyncJsonResponse::_contentHash(uint32_t &hash) {
+  if (!_isValid) {
+    return false;
+  }
+  HashPrint dest;
+#if ARDUINOJSON_VERSION_MAJOR == 5
+  _root.prettyPrintTo(dest);
+#else
+  serializeJsonPretty(_root, dest);
+#endif
+  hash = dest.hash();
+  return true;
+}
+
+bool PrettyAsyncJsonResponse::_contentPrint(Print &out) {
+  if (!_isValid) {
+    return false;
+  }
+#if ARDUINOJSON_VERSION_MAJOR == 5
+  _root.prettyPrintTo(out);
+#else
+  serializeJsonPretty(_root, out);
+#endif
+  return true;
+}
+
 #if ARDUINOJSON_VERSION_MAJOR == 6
 AsyncCallbackJsonWebHandler::AsyncCallbackJsonWebHandler(const String &uri, ArJsonRequestHandlerFunction onRequest, size_t maxJsonBufferSize)
   : _uri(uri), _method(HTTP_GET | HTTP_POST | HTTP_PUT | HTTP_PATCH), _onRequest(onRequest), maxJsonBufferSize(maxJsonBufferSize), _maxContentLength(16384) {}
@@ -96,15 +148,15 @@ AsyncCallbackJsonWebHandler::AsyncCallbackJsonWebHandler(const String &uri, ArJs
 #endif
 
 bool AsyncCallbackJsonWebHandler::canHandle(AsyncWebServerRequest *request) const {
-  if (!_onRequest || !request->isHTTP() || !(_method & request->method())) {
+  if (!_onRequest || !request->isHTTP() || !request->methodMatches(_method)) {
     return false;
   }
 
-  if (_uri.length() && (_uri != request->url() && !request->url().startsWith(_uri + "/"))) {
+  if (!route().matches(request->url())) {
     return false;
   }
 
-  if (request->method() != HTTP_GET && !request->contentType().equalsIgnoreCase(asyncsrv::T_application_json)) {
+  if (request->method() != HTTP_GET && request->method() != HTTP_HEAD && !request->contentType().equalsIgnoreCase(asyncsrv::T_application_json)) {
     return false;
   }
 
@@ -113,8 +165,8 @@ bool AsyncCallbackJsonWebHandler::canHandle(AsyncWebServerRequest *request) cons
 
 void AsyncCallbackJsonWebHandler::handleRequest(AsyncWebServerRequest *request) {
   if (_onRequest) {
-    // GET request:
-    if (request->method() == HTTP_GET) {
+    // GET / HEAD request:
+    if (request->method() == HTTP_GET || request->method() == HTTP_HEAD) {
       JsonVariant json;
       _onRequest(request, json);
       return;
@@ -17,6 +17,7 @@
 #include <ESPAsyncWebServer.h>
 
 #include "ChunkPrint.h"
+#include "HashPrint.h"
 
 #if ARDUINOJSON_VERSION_MAJOR == 6
 #ifndef DYNAMIC_JSON_DOCUMENT_SIZE
@@ -54,6 +55,8 @@ public:
     return _jsonBuffer.size();
   }
   size_t _fillBuffer(uint8_t *data, size_t len);
+  bool _contentHash(uint32_t &hash);
+  bool _contentPrint(Print &out);
 #if ARDUINOJSON_VERSION_MAJOR >= 6
   bool overflowed() const {
     return _jsonBuffer.overflowed();
@@ -70,6 +73,8 @@ public:
 #endif
   size_t setLength();
   size_t _fillBuffer(uint8_t *data, size_t len);
+  bool _contentHash(uint32_t &hash);
+  bool _contentPrint(Print &out);
 };
 
 typedef std::function<void(AsyncWebServerRequest *request, JsonVariant &json)> ArJsonRequestHandlerFunction;
@@ -102,6 +107,9 @@ public:
   }
 
   bool canHandle(AsyncWebServerRequest *request) const override final;
+  AsyncWebRoute route() const override final {
+    return AsyncWebRoute(_uri.length() ? ROUTE_SEGMENT : ROUTE_ANY, _uri.c_str(), _uri.length(), _method);
+  }
   void handleRequest(AsyncWebServerRequest *request) override final;
   void handleUpload(
     __unused AsyncWebServerRequest *request, __unused const String &filename, __unused size_t index, __unused uint8_t *data, __unused size_t len,
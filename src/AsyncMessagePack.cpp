@@ -41,6 +41,24 @@ size_t AsyncMessagePackResponse::_fillBuffer(uint8_t *data, size_t len) {
   return len;
 }
 
+bool AsyncMessagePackResponse::_contentHash(uint32_t &hash) {
+  if (!_isValid) {
+    return false;
+  }
+  HashPrint dest;
+  serializeMsgPack(_root, dest);
+  hash = dest.hash();
+  return true;
+}
+
+bool AsyncMessagePackResponse::_contentPrint(Print &out) {
+  if (!_isValid) {
+    return false;
+  }
+  serializeMsgPack(_root, out);
+  return true;
+}
+
 #if ARDUINOJSON_VERSION_MAJOR == 6
 AsyncCallbackMessagePackWebHandler::AsyncCallbackMessagePackWebHandler(
   const String &uri, ArMessagePackRequestHandlerFunction onRequest, size_t maxJsonBufferSize
@@ -52,15 +70,15 @@ AsyncCallbackMessagePackWebHandler::AsyncCallbackMessagePackWebHandler(const Str
 #endif
 
 bool AsyncCallbackMessagePackWebHandler::canHandle(AsyncWebServerRequest *request) const {
-  if (!_onRequest || !request->isHTTP() || !(_method & request->method())) {
+  if (!_onRequest || !request->isHTTP() || !request->methodMatches(_method)) {
     return false;
   }
 
-  if (_uri.length() && (_uri != request->url() && !request->url().startsWith(_uri + "/"))) {
+  if (!route().matches(request->url())) {
     return false;
   }
 
-  if (request->method() != HTTP_GET && !request->contentType().equalsIgnoreCase(asyncsrv::T_application_msgpack)) {
+  if (request->method() != HTTP_GET && request->method() != HTTP_HEAD && !request->contentType().equalsIgnoreCase(asyncsrv::T_application_msgpack)) {
     return false;
   }
 
@@ -69,7 +87,7 @@ bool AsyncCallbackMessagePackWebHandler::canHandle(AsyncWebServerRequest *reques
 
 void AsyncCallbackMessagePackWebHandler::handleRequest(AsyncWebServerRequest *request) {
   if (_onRequest) {
-    if (request->method() == HTTP_GET) {
+    if (request->method() == HTTP_GET || request->method() == HTTP_HEAD) {
       JsonVariant json;
       _onRequest(request, json);
       return;
@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+#ifndef ASYNCROUTES_H_
+#define ASYNCROUTES_H_
+
+/*
+ * Compile-time route table, for the firmwares whose routes are known at build time.
+ *
+ * The routes are types, the table is computed by the compiler: a perfect hash of the paths, the methods and the
+ * handler functions are constant arrays stored in flash. The whole table is one AsyncWebHandler, matching a request
+ * is one hash of its URL and one comparison, without any allocation.
+ *
+ *   static void handleRoot(AsyncWebServerRequest *request) { ... }
+ *   static void handleConfig(AsyncWebServerRequest *request) { ... }
+ *
+ *   // C++20: the paths are string literals
+ *   server.addHandler(new AsyncRoutes<AsyncGet<"/", handleRoot>, AsyncPost<"/api/cfg", handleConfig>>());
+ *
+ *   // C++17 (and C++20): the paths are constant arrays
+ *   static constexpr char rootPath[] = "/";
+ *   static constexpr char configPath[] = "/api/cfg";
+ *   server.addHandler(new AsyncRoutes<AsyncGet<rootPath, handleRoot>, AsyncPost<configPath, handleConfig>>());
+ *
+ * The paths are matched exactly. Several routes can have the same path with different methods:
+ * the first one (in the list) accepting the method of the request handles it.
+ */
+
+#include "ESPAsyncWebServer.h"
+
+#if __cplusplus < 201703L
+#error "AsyncRoutes.h requires C++17"
+#endif
+
+using ArRequestHandlerPtr = void (*)(AsyncWebServerRequest *request);
+
+namespace asyncsrv {
+
+constexpr size_t routeLength(const char *path) {
+  size_t len = 0;
+  while (path[len]) {
+    len++;
+  }
+  return len;
+}
+
+constexpr bool routeEquals(const char *a, size_t aLen, const char *b, size_t bLen) {
+  if (aLen != bLen) {
+    return false;
+  }
+  for (size_t i = 0; i < aLen; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// FNV-1a, as HashPrint::hash()
+constexpr uint32_t routeHash(const char *path, size_t len, uint32_t seed) {
+  for (size_t i = 0; i < len; i++) {
+    seed = (seed ^ (uint8_t)path[i]) * 16777619UL;
+  }
+  return seed;
+}
+
+}  // namespace asyncsrv
+
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+// path given as a string literal to the templates
+template <size_t N> struct AsyncRoutePath {
+  char value[N];
+  constexpr AsyncRoutePath(const char (&path)[N]) : value{} {
+    for (size_t i = 0; i < N; i++) {
+      value[i] = path[i];
+    }
+  }
+};
+
+template <size_t N> constexpr const char *asyncRoutePath(const AsyncRoutePath<N> &path) {
+  return path.value;
+}
+
+#define ASYNC_ROUTE_PATH AsyncRoutePath
+#else
+constexpr const char *asyncRoutePath(const char *path) {
+  return path;
+}
+
+#define ASYNC_ROUTE_PATH const char *
+#endif
+
+// a route: requests with one of the methods on the path are handled by the function
+template <WebRequestMethodComposite Methods, ASYNC_ROUTE_PATH Path, ArRequestHandlerPtr Handler> struct AsyncRoute {
+  static constexpr WebRequestMethodComposite methods = Methods;
+  static constexpr const char *path = asyncRoutePath(Path);
+  static constexpr ArRequestHandlerPtr handler = Handler;
+};
+
+template <ASYNC_ROUTE_PATH Path, ArRequestHandlerPtr Handler> using AsyncGet = AsyncRoute<HTTP_GET, Path, Handler>;
+template <ASYNC_ROUTE_PATH Path, ArRequestHandlerPtr Handler> using AsyncPost = AsyncRoute<HTTP_POST, Path, Handler>;
+template <ASYNC_ROUTE_PATH Path, ArRequestHandlerPtr Handler> using AsyncPut = AsyncRoute<HTTP_PUT, Path, Handler>;
+template <ASYNC_ROUTE_PATH Path, ArRequestHandlerPtr Handler> using AsyncPatch = AsyncRoute<HTTP_PATCH, Path, Handler>;
+template <ASYNC_ROUTE_PATH Path, ArRequestHandlerPtr Handler> using AsyncDelete = AsyncRoute<HTTP_DELETE, Path, Handler>;
+template <ASYNC_ROUTE_PATH Path, ArRequestHandlerPtr Handler> using AsyncAny = AsyncRoute<HTTP_ANY, Path, Handler>;
+
+/**
+ * @brief Handler of a route table computed at compile time (see AsyncRoute).
+ */
+template <typename... Routes> class AsyncRoutes : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) const override final {
+    return _find(request) >= 0;
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override final {
+    const int route = _find(request);
+    if (route >= 0) {
+      _handlers[route](request);
+    }
+  }
+
+  AsyncWebRoute route() const override final {
+    // the path common to all the routes, so that the server only checks this handler for the requests below it
+    return _prefix ? AsyncWebRoute(ROUTE_PREFIX, _paths[0], _prefix, _allMethods) : AsyncWebRoute(ROUTE_ANY, nullptr, 0, _allMethods);
+  }
+
+private:
+  static constexpr size_t N = sizeof...(Routes);
+  static_assert(N > 0 && N < 0xFFFF, "AsyncRoutes: 1 to 65534 routes");
+
+  // 4 slots per route at least: a seed is found in a few tries
+  static constexpr size_t _size = [] {
+    size_t size = 1;
+    while (size < 4 * N) {
+      size *= 2;
+    }
+    return size;
+  }();
+
+  static constexpr const char *_paths[N] = {Routes::path...};
+  static constexpr size_t _lengths[N] = {asyncsrv::routeLength(Routes::path)...};
+  static constexpr WebRequestMethodComposite _methods[N] = {Routes::methods...};
+  static constexpr ArRequestHandlerPtr _handlers[N] = {Routes::handler...};
+
+  static constexpr WebRequestMethodComposite _allMethods = (Routes::methods | ...);
+  static constexpr size_t _prefix = [] {
+    size_t len = _lengths[0];
+    for (size_t i = 1; i < N; i++) {
+      size_t common = 0;
+      while (common < len && common < _lengths[i] && _paths[i][common] == _paths[0][common]) {
+        common++;
+      }
+      len = common;
+    }
+    return len;
+  }();
+
+  struct Table {
+    bool found;
+    uint32_t seed;
+    uint16_t slots[_size];  // first route (+1) of the path hashed to the slot, 0 if none
+    uint16_t next[N];       // next route (+1) with the same path, 0 if none
+  };
+
+  static constexpr Table _table = [] {
+    Table table = {};
+    uint16_t first[N] = {};  // first route (+1) with the same path
+    for (size_t i = 0; i < N; i++) {
+      for (size_t j = 0; j < i && !first[i]; j++) {
+        if (asyncsrv::routeEquals(_paths[i], _lengths[i], _paths[j], _lengths[j])) {
+          first[i] = j + 1;
+        }
+      }
+      if (first[i]) {
+        // append to the list of routes of that path, in order
+        size_t last = first[i] - 1;
+        while (table.next[last]) {
+          last = table.next[last] - 1;
+        }
+        table.next[last] = i + 1;
+      }
+    }
+    for (uint32_t seed = 2166136261UL; seed < 2166136261UL + 100000; seed++) {
+      bool collision = false;
+      for (size_t s = 0; s < _size; s++) {
+        table.slots[s] = 0;
+      }
+      for (size_t i = 0; i < N && !collision; i++) {
+        if (!first[i]) {
+          uint16_t &slot = table.slots[asyncsrv::routeHash(_paths[i], _lengths[i], seed) & (_size - 1)];
+          collision = slot != 0;
+          slot = i + 1;
+        }
+      }
+      if (!collision) {
+        table.found = true;
+        table.seed = seed;
+        break;
+      }
+    }
+    return table;
+  }();
+  static_assert(_table.found, "AsyncRoutes: no perfect hash found for the paths");
+
+  // index of the route handling the request, -1 if none
+  static int _find(AsyncWebServerRequest *request) {
+    const char *url = request->url().c_str();
+    const size_t len = request->url().length();
+    size_t route = _table.slots[asyncsrv::routeHash(url, len, _table.seed) & (_size - 1)];
+    if (!route || len != _lengths[route - 1] || memcmp(url, _paths[route - 1], len) != 0) {
+      return -1;
+    }
+    for (; route; route = _table.next[route - 1]) {
+      if (request->methodMatches(_methods[route - 1])) {
+        return route - 1;
+      }
+    }
+    return -1;
+  }
+};
+
+#endif /* ASYNCROUTES_H_ */
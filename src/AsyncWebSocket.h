@@ -394,6 +394,9 @@ public:
   void _handleDisconnect(AsyncWebSocketClient *client);
   void _handleEvent(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
   bool canHandle(AsyncWebServerRequest *request) const override final;
+  AsyncWebRoute route() const override final {
+    return AsyncWebRoute(ROUTE_EXACT, _url.c_str(), _url.length(), HTTP_ANY);
+  }
   void handleRequest(AsyncWebServerRequest *request) override final;
 
   //  messagebuffer functions/objects.
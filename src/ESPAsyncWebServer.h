@@ -9,9 +9,12 @@
 #include <lwip/tcpbase.h>
 
 #include <algorithm>
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -51,6 +54,42 @@
 #define ASYNCWEBSERVER_RX_TIMEOUT 3  // Seconds for timeout
 #endif
 
+#ifndef ASYNCWEBSERVER_PATH_ARGS_MAX
+#define ASYNCWEBSERVER_PATH_ARGS_MAX 8  // Maximum number of arguments captured in the path of a request (see AsyncPathPattern)
+#endif
+
+#ifndef ASYNCWEBSERVER_RATE_LIMIT_CLIENTS
+#define ASYNCWEBSERVER_RATE_LIMIT_CLIENTS 16  // Clients tracked by default by an AsyncRateLimitMiddleware
+#endif
+
+// Response cache (see AsyncCacheMiddleware)
+#ifndef ASYNCWEBSERVER_CACHE_BYTES
+#define ASYNCWEBSERVER_CACHE_BYTES 8192  // Memory used by default by an AsyncCacheMiddleware for the cached responses
+#endif
+#ifndef ASYNCWEBSERVER_CACHE_TTL
+#define ASYNCWEBSERVER_CACHE_TTL 5  // Seconds a response is cached by default
+#endif
+
+// Access log (see AsyncAccessLogMiddleware)
+#ifndef ASYNCWEBSERVER_ACCESS_LOG_PATH
+#define ASYNCWEBSERVER_ACCESS_LOG_PATH 48  // Characters of the path kept in a record, longer paths are truncated
+#endif
+#ifndef ASYNCWEBSERVER_ACCESS_LOG_TASK_PRIORITY
+#define ASYNCWEBSERVER_ACCESS_LOG_TASK_PRIORITY 1  // ESP32: priority of the task writing the log
+#endif
+#ifndef ASYNCWEBSERVER_ACCESS_LOG_TASK_STACK
+#define ASYNCWEBSERVER_ACCESS_LOG_TASK_STACK 3072
+#endif
+
+// Fair send scheduler (see AsyncWebServer::setSendScheduler)
+#ifndef ASYNCWEBSERVER_SEND_QUANTUM
+#define ASYNCWEBSERVER_SEND_QUANTUM 1436  // Bytes granted per round to a bulk response, doubled for each higher priority class
+#endif
+
+#ifndef ASYNCWEBSERVER_SEND_ROUND_MS
+#define ASYNCWEBSERVER_SEND_ROUND_MS 10  // Maximum duration of a round when some responses are blocked by their connection
+#endif
+
 class AsyncWebServer;
 class AsyncWebServerRequest;
 class AsyncWebServerResponse;
@@ -59,8 +98,12 @@ class AsyncWebParameter;
 class AsyncWebRewrite;
 class AsyncWebHandler;
 class AsyncStaticWebHandler;
+class AsyncBundleWebHandler;
+struct AsyncBundle;
+class AsyncWebRouter;
 class AsyncCallbackWebHandler;
 class AsyncResponseStream;
+class AsyncMiddleware;
 class AsyncMiddlewareChain;
 
 #if defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350)
@@ -104,6 +147,7 @@ public:
 
 typedef uint8_t WebRequestMethodComposite;
 typedef std::function<void(void)> ArDisconnectHandler;
+typedef std::function<void(AsyncWebServerRequest *request, AsyncWebServerResponse *response)> ArRespondHandler;
 
 /*
  * PARAMETER :: Chainable object to hold GET/POST and FILE parameters
@@ -205,8 +249,71 @@ typedef enum {
   AUTH_DENIED = 255,  // always returns 401
 } AsyncAuthType;
 
+// priority classes of the fair send scheduler
+typedef enum {
+  SEND_PRIORITY_INTERACTIVE = 0,  // small API responses, served first with the largest quantum
+  SEND_PRIORITY_NORMAL = 1,
+  SEND_PRIORITY_BULK = 2,  // large downloads
+  SEND_PRIORITY_MAX
+} AsyncSendPriority;
+
 typedef std::function<size_t(uint8_t *, size_t, size_t)> AwsResponseFiller;
 typedef std::function<String(const String &)> AwsTemplateProcessor;
+// returns true when the stream has delivered all its content (index is the number of bytes read so far)
+typedef std::function<bool(Stream &stream, size_t index)> AwsStreamCompletion;
+
+// content directly addressable in memory (memory-mapped file or flash partition), see AsyncMappedResponse
+struct AsyncMappedRegion {
+  const uint8_t *data = nullptr;
+  size_t length = 0;
+  // unmaps the region, called once the response does not use it anymore
+  std::function<void()> release;
+};
+// maps the file at path, returns false if it cannot be mapped (the file is then read through the file system)
+typedef std::function<bool(const String &path, AsyncMappedRegion &region)> AwsFileMapper;
+
+// part of the URL captured by a path pattern
+struct AsyncPathSpan {
+  uint16_t start;
+  uint16_t length;
+};
+
+/**
+ * @brief Path pattern compiled once, like "/api/devices/{id}/sensors/{sensor:int}".
+ * A capture is written {name} (a non-empty part of a path segment), {name:int} (digits) or {name:*} (the rest of the path,
+ * including '/'). The whole URL must match, and the captures are recorded as spans of the URL, without any allocation.
+ */
+class AsyncPathPattern {
+public:
+  // returns false if the pattern has no capture or is malformed
+  bool compile(const String &pattern);
+  bool valid() const {
+    return !_tokens.empty();
+  }
+  bool match(const String &url, AsyncPathSpan *spans, size_t &count) const;
+  // index of a capture by name, -1 if not found
+  int indexOf(const char *name) const;
+  // length of the literal part before the first capture
+  size_t prefixLength() const;
+
+private:
+  typedef enum : uint8_t {
+    TOKEN_LITERAL,
+    TOKEN_SEGMENT,
+    TOKEN_INT,
+    TOKEN_REST,
+  } TokenType;
+  // literal text or name of the capture, in _pattern
+  struct Token {
+    TokenType type;
+    uint16_t start;
+    uint16_t length;
+  };
+  String _pattern;
+  std::vector<Token> _tokens;
+  uint8_t _captures = 0;
+  bool _match(size_t token, const char *url, size_t pos, size_t len, AsyncPathSpan *spans, size_t capture) const;
+};
 
 using AsyncWebServerRequestPtr = std::weak_ptr<AsyncWebServerRequest>;
 
@@ -216,6 +323,9 @@ class AsyncWebServerRequest {
   friend class AsyncWebServer;
   friend class AsyncCallbackWebHandler;
   friend class AsyncFileResponse;
+  friend class AsyncAbstractResponse;
+  friend class AsyncCacheMiddleware;
+  friend class AsyncCoalesceMiddleware;
 
 private:
   AsyncClient *_client;
@@ -223,10 +333,20 @@ private:
   AsyncWebHandler *_handler;
   AsyncWebServerResponse *_response;
   ArDisconnectHandler _onDisconnectfn;
+  ArRespondHandler _onRespondfn;
+  ArRespondHandler _onFinishfn;
 
   bool _sent = false;                            // response is sent
   bool _paused = false;                          // request is paused (request continuation)
   std::shared_ptr<AsyncWebServerRequest> _this;  // shared pointer to this request
+  AsyncWebRouter *_routes = nullptr;             // routing snapshot the request was routed with, released with it
+
+  // middlewares being run: the next one is _chain[_chainIndex], _chainNext is the "next" given to them
+  std::shared_ptr<const std::vector<std::shared_ptr<AsyncMiddleware>>> _chain;
+  size_t _chainIndex = 0;
+  std::function<void(void)> _chainNext{[this]() {
+    _nextMiddleware();
+  }};
 
   String _temp;
   uint8_t _parseState;
@@ -248,7 +368,11 @@ private:
 
   std::list<AsyncWebHeader> _headers;
   std::list<AsyncWebParameter> _params;
-  std::list<String> _pathParams;
+  // arguments captured in the path by the handler, as spans of _url, converted to String on first access
+  AsyncPathSpan _pathSpans[ASYNCWEBSERVER_PATH_ARGS_MAX];
+  uint8_t _pathSpanCount = 0;
+  const AsyncPathPattern *_pathPattern = nullptr;  // names of the arguments, null for a regex
+  mutable std::vector<String> _pathParams;
 
   std::unordered_map<const char *, String, std::hash<const char *>, std::equal_to<const char *>> _attributes;
 
@@ -272,7 +396,7 @@ private:
   void _onDisconnect();
   void _onData(void *buf, size_t len);
 
-  void _addPathParam(const char *param);
+  void _setPathArgs(const AsyncPathPattern *pattern, size_t count);
 
   bool _parseReqHead();
   bool _parseReqHeader();
@@ -287,6 +411,9 @@ private:
 
   void _send();
   void _runMiddlewareChain();
+  void _nextMiddleware();
+  // several middlewares can observe the same request: the handlers are called in the order they were added
+  static void _addRespondHandler(ArRespondHandler &handlers, ArRespondHandler fn);
 
   static void _getEtag(uint8_t trailer[4], char *serverETag);
 
@@ -306,6 +433,11 @@ public:
   WebRequestMethodComposite method() const {
     return _method;
   }
+  // true if the request method is one of the given methods.
+  // A HEAD request is answered like a GET request (without the body), so it also matches HTTP_GET.
+  bool methodMatches(WebRequestMethodComposite methods) const {
+    return (methods & _method) || (_method == HTTP_HEAD && (methods & HTTP_GET));
+  }
   const String &url() const {
     return _url;
   }
@@ -340,6 +472,15 @@ public:
     return isExpectedRequestedConnType(RCT_DEFAULT, RCT_HTTP);
   }
   void onDisconnect(ArDisconnectHandler fn);
+  // For internal use (see AsyncCoalesceMiddleware): fn is called once, with the response just before it is sent,
+  // or with a null response if the request is deleted without having sent one
+  void _onRespond(ArRespondHandler fn) {
+    _addRespondHandler(_onRespondfn, fn);
+  }
+  // For internal use (see AsyncConcurrencyLimitMiddleware): fn is called when the request is deleted, with its response if any
+  void _onFinish(ArRespondHandler fn) {
+    _addRespondHandler(_onFinishfn, fn);
+  }
 
   // hash is the string representation of:
   //  base64(user:pass) for basic or
@@ -359,12 +500,12 @@ public:
   }
 
 #ifndef ESP8266
-  [[deprecated("All headers are now collected. Use removeHeader(name) or AsyncHeaderFreeMiddleware if you really need to free some headers.")]]
+  [[deprecated("All headers are now collected. Use AsyncWebServer::keepHeader(name) if you really need to free some headers.")]]
 #endif
   void addInterestingHeader(__unused const char *name) {
   }
 #ifndef ESP8266
-  [[deprecated("All headers are now collected. Use removeHeader(name) or AsyncHeaderFreeMiddleware if you really need to free some headers.")]]
+  [[deprecated("All headers are now collected. Use AsyncWebServer::keepHeader(name) if you really need to free some headers.")]]
 #endif
   void addInterestingHeader(__unused const String &name) {
   }
@@ -424,6 +565,12 @@ public:
   void send(Stream &stream, const String &contentType, size_t len, AwsTemplateProcessor callback = nullptr) {
     send(beginResponse(stream, contentType, len, callback));
   }
+  void send(Stream &stream, const char *contentType, AwsStreamCompletion completion, AwsTemplateProcessor callback = nullptr) {
+    send(beginResponse(stream, contentType, completion, callback));
+  }
+  void send(Stream &stream, const String &contentType, AwsStreamCompletion completion, AwsTemplateProcessor callback = nullptr) {
+    send(beginResponse(stream, contentType, completion, callback));
+  }
 
   void send(const char *contentType, size_t len, AwsResponseFiller callback, AwsTemplateProcessor templateCallback = nullptr) {
     send(beginResponse(contentType, len, callback, templateCallback));
@@ -488,6 +635,11 @@ public:
   AsyncWebServerResponse *beginResponse(Stream &stream, const String &contentType, size_t len, AwsTemplateProcessor callback = nullptr) {
     return beginResponse(stream, contentType.c_str(), len, callback);
   }
+  // stream of unknown length, sent until the completion predicate returns true
+  AsyncWebServerResponse *beginResponse(Stream &stream, const char *contentType, AwsStreamCompletion completion, AwsTemplateProcessor callback = nullptr);
+  AsyncWebServerResponse *beginResponse(Stream &stream, const String &contentType, AwsStreamCompletion completion, AwsTemplateProcessor callback = nullptr) {
+    return beginResponse(stream, contentType.c_str(), completion, callback);
+  }
 
   AsyncWebServerResponse *beginResponse(const char *contentType, size_t len, AwsResponseFiller callback, AwsTemplateProcessor templateCallback = nullptr);
   AsyncWebServerResponse *beginResponse(const String &contentType, size_t len, AwsResponseFiller callback, AwsTemplateProcessor templateCallback = nullptr) {
@@ -599,10 +751,19 @@ public:
   bool hasArg(const __FlashStringHelper *data) const;  // check if F(argument) exists
 #endif
 
-  const String &ASYNCWEBSERVER_REGEX_ATTRIBUTE pathArg(size_t i) const;
-  const String &ASYNCWEBSERVER_REGEX_ATTRIBUTE pathArg(int i) const {
+  // number of arguments captured in the path by the pattern (or the regex) of the handler
+  size_t pathArgs() const {
+    return _pathSpanCount;
+  }
+  const String &pathArg(size_t i) const;
+  const String &pathArg(int i) const {
     return i < 0 ? emptyString : pathArg((size_t)i);
   }
+  // argument captured in the path by name: pathArg("id") for the pattern "/devices/{id}"
+  const String &pathArg(const char *name) const;
+  const String &pathArg(const String &name) const {
+    return pathArg(name.c_str());
+  }
 
   // get request header value by name
   const String &header(const char *name) const;
@@ -719,6 +880,8 @@ bool ON_AP_FILTER(AsyncWebServerRequest *request);
  * 2. decide whether to proceed or not with the next handler
  * */
 
+// Runs the rest of the chain then the handler. It can be called later, outside of run(), after pausing the request:
+// the response is then sent when the chain completes (see AsyncWebServerRequest::pause())
 using ArMiddlewareNext = std::function<void(void)>;
 using ArMiddlewareCallback = std::function<void(AsyncWebServerRequest *request, ArMiddlewareNext next)>;
 
@@ -759,11 +922,22 @@ public:
   void addMiddlewares(std::vector<AsyncMiddleware *> middlewares);
   bool removeMiddleware(AsyncMiddleware *middleware);
 
-  // For internal use only
-  void _runChain(AsyncWebServerRequest *request, ArMiddlewareNext finalizer);
+  // For internal use only: the middlewares of parent (if any) followed by the ones of this chain, in one array.
+  // The array is only rebuilt when a middleware was added or removed since the last call. It is never modified:
+  // a new one is built, so that the requests still walking the previous one (paused) keep it, with its middlewares
+  // (a removed middleware owned by the chain is deleted with the last array using it).
+  std::shared_ptr<const std::vector<std::shared_ptr<AsyncMiddleware>>> _compileChain(const AsyncMiddlewareChain *parent);
 
 protected:
-  std::list<AsyncMiddleware *> _middlewares;
+  // the middlewares added with _freeOnRemoval are owned, the others are only referenced
+  std::vector<std::shared_ptr<AsyncMiddleware>> _middlewares;
+
+private:
+  std::shared_ptr<const std::vector<std::shared_ptr<AsyncMiddleware>>> _chain;
+  const AsyncMiddlewareChain *_chainParent = nullptr;
+  uint32_t _chainRevision = 0;
+  // incremented each time a middleware is added to or removed from any chain
+  static uint32_t _revision;
 };
 
 // AsyncAuthenticationMiddleware is a middleware that checks if the request is authenticated
@@ -833,7 +1007,8 @@ private:
   ArAuthorizeFunction _authz;
 };
 
-// remove all headers from the incoming request except the ones provided in the constructor
+// remove all headers from the incoming request except the ones provided in the constructor.
+// They are removed once parsed: AsyncWebServer::keepHeader() avoids storing them at all
 class AsyncHeaderFreeMiddleware : public AsyncMiddleware {
 public:
   void keep(const char *name) {
@@ -885,55 +1060,391 @@ private:
   bool _enabled = true;
 };
 
+typedef enum {
+  ACCESS_LOG_COMMON,  // Common Log Format: 192.168.4.2 - - [17/Oct/2026:10:00:00 +0000] "GET /index.html HTTP/1.1" 200 1043
+  ACCESS_LOG_JSON,    // JSON lines: {"time":...,"ip":"192.168.4.2","method":"GET","path":"/index.html","status":200,"bytes":1043,"ms":3}
+} AsyncAccessLogFormat;
+
+// What is kept of a request in the access log: fixed size, copied into the ring without allocation
+struct AsyncAccessLogRecord {
+  uint32_t time;        // seconds since epoch, see time()
+  uint8_t ip[16];       // address of the client: 4 bytes for IPv4, 16 for IPv6
+  bool ipv6;
+  uint32_t bytes;       // content length of the response
+  uint32_t duration;    // milliseconds spent in the handler (and the next middlewares)
+  const char *method;   // static string, see AsyncWebServerRequest::methodToString()
+  uint16_t status;      // 0 if there is no response yet (request paused)
+  uint8_t version;      // HTTP/1.x
+  uint8_t pathLength;
+  char path[ASYNCWEBSERVER_ACCESS_LOG_PATH];
+};
+
+// Access log middleware: unlike AsyncLoggingMiddleware, nothing is printed while the request is handled.
+// A record of each request is written in a lock-free ring buffer, and formatted to the output later:
+// by a low priority task on ESP32, by calling flush() (i.e. from loop()) on the other platforms.
+// When the ring is full, the records are dropped and counted: the count is written to the log with the next records.
+class AsyncAccessLogMiddleware : public AsyncMiddleware {
+public:
+  ~AsyncAccessLogMiddleware();
+
+  // output can be any Print, i.e. Serial or a File opened for append
+  bool begin(Print &output, AsyncAccessLogFormat format = ACCESS_LOG_COMMON, size_t records = 32);
+  void end();
+
+  // formats up to max pending records to the output, returns the number of records written
+  size_t flush(size_t max = SIZE_MAX);
+  // records dropped because the ring was full, since begin()
+  uint32_t dropped() const {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+
+  void run(AsyncWebServerRequest *request, ArMiddlewareNext next);
+
+private:
+  Print *_out = nullptr;
+  AsyncAccessLogFormat _format = ACCESS_LOG_COMMON;
+  // single producer (network task), single consumer (flush()) ring
+  AsyncAccessLogRecord *_ring = nullptr;
+  size_t _mask = 0;
+  std::atomic<size_t> _head{0};  // next record written by run()
+  std::atomic<size_t> _tail{0};  // next record formatted by flush()
+  std::atomic<uint32_t> _dropped{0};
+  uint32_t _droppedLogged = 0;
+  std::atomic<bool> _running{false};
+  std::atomic<uint32_t> _writers{0};  // run() calls writing a record: the ring is only freed once there are none
+  std::atomic<void *> _task{nullptr};  // ESP32: TaskHandle_t of the task calling flush()
+
+  void _write(const AsyncAccessLogRecord &record);
+#ifdef ESP32
+  static void _taskLoop(void *self);
+#endif
+};
+
 // CORS Middleware
 class AsyncCorsMiddleware : public AsyncMiddleware {
 public:
+  AsyncCorsMiddleware() {
+    _render();
+  }
+
+  // value of access-control-allow-origin sent to all the origins ("*" by default), unless origins were added
   void setOrigin(const char *origin) {
     _origin = origin;
+    _render();
   }
+  // allows an origin: once origins are added, only the requests from one of them are answered with the CORS headers,
+  // access-control-allow-origin being their own origin, and the preflight requests from the other origins are refused
+  void addOrigin(const char *origin);
+  void clearOrigins();
   void setMethods(const char *methods) {
     _methods = methods;
+    _render();
   }
   void setHeaders(const char *headers) {
     _headers = headers;
+    _render();
   }
   void setAllowCredentials(bool credentials) {
     _credentials = credentials;
+    _render();
   }
   void setMaxAge(uint32_t seconds) {
     _maxAge = seconds;
+    _render();
   }
 
+  // adds the CORS headers for the request to its response, nothing if its origin is not allowed.
+  // They are added as a shared block, not visible to getHeader() / removeHeader(), unless the response already has
+  // some of them (or a Vary header): they are then added one by one, replacing the existing ones.
+  void addCORSHeaders(AsyncWebServerRequest *request, AsyncWebServerResponse *response);
+  // adds the CORS headers without access-control-allow-origin when origins were added
   void addCORSHeaders(AsyncWebServerResponse *response);
 
   void run(AsyncWebServerRequest *request, ArMiddlewareNext next);
 
 private:
+  struct Origin {
+    String origin;
+    uint32_t hash;
+    std::shared_ptr<const String> preflight;  // rendered on the first preflight request from this origin
+  };
+
   String _origin = "*";
   String _methods = "*";
   String _headers = "*";
   bool _credentials = true;
   uint32_t _maxAge = 86400;
+
+  std::vector<Origin> _origins;
+  std::vector<uint16_t> _originSlots;  // open addressing: origin (+1) hashed to the slot, 0 if empty. Size is a power of 2.
+  // the headers other than access-control-allow-origin (and the latter when no origin was added)
+  std::shared_ptr<const String> _block;
+  std::shared_ptr<const String> _preflight;  // when no origin was added
+
+  void _render();
+  Origin *_findOrigin(const String &origin);
+  std::shared_ptr<const String> _renderPreflight(const char *origin) const;
+  void _addHeaders(AsyncWebServerResponse *response) const;
 };
 
 // Rate limit Middleware
+using ArRateLimitKeyFunction = std::function<uint32_t(AsyncWebServerRequest *request)>;
+
+// Rate limiting middleware: each client (by default its IP address) has a bucket of maxRequests tokens, refilled at
+// maxRequests per window. A request uses one token, or is answered with 429 Too Many Requests and Retry-After when the bucket
+// is empty. The responses carry the RateLimit-Limit, RateLimit-Remaining and RateLimit-Reset headers.
+// The buckets are kept in a fixed-size table: when it is full, the bucket of the client seen the longest ago is reused.
 class AsyncRateLimitMiddleware : public AsyncMiddleware {
 public:
   void setMaxRequests(size_t maxRequests) {
     _maxRequests = maxRequests;
+    _clear();
   }
   void setWindowSize(uint32_t seconds) {
     _windowSizeMillis = seconds * 1000;
+    _clear();
+  }
+  // number of clients tracked at the same time (default ASYNCWEBSERVER_RATE_LIMIT_CLIENTS), rounded up to a power of 2
+  void setMaxClients(size_t clients);
+  // key identifying the client of a request (default: its IPv4 address or a hash of its IPv6 address), i.e. an API key or a user id
+  void setKey(ArRateLimitKeyFunction fn) {
+    _key = fn;
+    _clear();
   }
 
+  // global limit, shared by all the callers
   bool isRequestAllowed(uint32_t &retryAfterSeconds);
+  // limit of the client of the request
+  bool isRequestAllowed(AsyncWebServerRequest *request, uint32_t &retryAfterSeconds);
 
   void run(AsyncWebServerRequest *request, ArMiddlewareNext next);
 
 private:
+  struct Bucket {
+    uint32_t key;
+    uint32_t lastSeen;  // millis() of the last request, 0 if the slot is free
+    uint64_t level;     // tokens left, in 1 / _maxRequests milliseconds: one token is _windowSizeMillis
+  };
+
   size_t _maxRequests = 0;
   uint32_t _windowSizeMillis = 0;
-  std::list<uint32_t> _requestTimes;
+  ArRateLimitKeyFunction _key;
+  std::vector<Bucket> _buckets;  // open addressing table of the clients, allocated on the first request
+  size_t _maxClients = ASYNCWEBSERVER_RATE_LIMIT_CLIENTS;
+  Bucket _global = {};  // see isRequestAllowed(retryAfterSeconds)
+
+  void _clear() {
+    _buckets.clear();
+    _global = {};
+  }
+  // bucket of the key in the table (a new one, full, if not found), nullptr if the table cannot be allocated
+  Bucket *_bucket(uint32_t key);
+  // takes a token from the bucket: remaining tokens, or retry after (seconds) when refused
+  bool _take(Bucket *bucket, uint32_t &remaining, uint32_t &resetSeconds, uint32_t &retryAfterSeconds);
+};
+
+// Adaptive concurrency limit Middleware (load shedding)
+// Limits the number of requests being served at the same time, from the end of their parsing until they are deleted
+// (response sent). The limit adapts to the service time of the requests (additive increase, multiplicative decrease):
+// it grows by one each time limit requests were served within the target latency while the limit was in use,
+// and is multiplied by the backoff ratio for each request served slower than that.
+// The requests above the limit are answered at once with a 503 Service Unavailable and Retry-After, rendered once.
+// The requests accepted by the bypass filter (i.e. health checks, admin routes) are never refused nor counted.
+class AsyncConcurrencyLimitMiddleware : public AsyncMiddleware {
+public:
+  // bounds of the limit (default 1 to 16), which starts at the maximum
+  void setLimits(size_t minLimit, size_t maxLimit) {
+    _minLimit = minLimit ? minLimit : 1;
+    _maxLimit = maxLimit < _minLimit ? _minLimit : maxLimit;
+    _limit = _maxLimit;
+  }
+  // service time above which a request is a sign of overload (default 500 ms)
+  void setTargetLatency(uint32_t ms) {
+    _targetLatency = ms;
+  }
+  // ratio applied to the limit for each request served above the target latency (default 0.9)
+  void setBackoff(float ratio) {
+    _backoff = ratio;
+  }
+  // Retry-After of the refused requests (default 1 second)
+  void setRetryAfter(uint32_t seconds) {
+    _retryAfter = seconds;
+    _refusal = nullptr;
+  }
+  void setBypass(ArRequestFilterFunction fn) {
+    _bypass = fn;
+  }
+
+  size_t limit() const {
+    return (size_t)_limit;
+  }
+  // requests being served
+  size_t inFlight() const {
+    return _inFlight;
+  }
+  // requests refused since the start
+  uint32_t refused() const {
+    return _refused;
+  }
+
+  void run(AsyncWebServerRequest *request, ArMiddlewareNext next);
+
+private:
+  size_t _minLimit = 1;
+  size_t _maxLimit = 16;
+  float _limit = 16;
+  float _backoff = 0.9f;
+  uint32_t _targetLatency = 500;
+  uint32_t _retryAfter = 1;
+  ArRequestFilterFunction _bypass;
+  size_t _inFlight = 0;
+  uint32_t _refused = 0;
+  std::shared_ptr<const String> _refusal;  // rendered on the first refused request
+
+  void _finish(uint32_t latency);
+};
+
+using ArETagVersionFunction = std::function<String(AsyncWebServerRequest *request)>;
+
+// Conditional GET Middleware
+// Adds a strong ETag to the successful GET / HEAD responses which do not have one, computed from their content
+// when it is known before being sent (string, PROGMEM, response streams, JSON...).
+// Answers 304 Not Modified instead when the If-None-Match header of the request matches, so the content is never sent.
+class AsyncETagMiddleware : public AsyncMiddleware {
+public:
+  // Set a function returning a version token for the request (i.e. a configuration revision), used as the ETag instead of the content hash.
+  // When the client is up to date, the handler is not even called.
+  // If the function returns an empty string, the ETag is computed from the content.
+  void setVersion(ArETagVersionFunction fn) {
+    _version = fn;
+  }
+
+  // returns true if the If-None-Match header of the request matches the given ETag
+  static bool matches(AsyncWebServerRequest *request, const String &etag);
+
+  void run(AsyncWebServerRequest *request, ArMiddlewareNext next);
+
+private:
+  ArETagVersionFunction _version;
+  void _sendNotModified(AsyncWebServerRequest *request, const String &etag);
+};
+
+// Response cache Middleware
+// Keeps the successful GET responses whose content is known before being sent (string, PROGMEM, response streams, JSON...),
+// and answers the next GET / HEAD requests of the same URL (same query parameters, same values of the request headers named
+// by the vary header of the response) from memory until they expire, without calling the handler.
+// The headers and content are kept as rendered bytes, shared by all the responses sent from them.
+// Not cached: the responses with cache-control no-store, no-cache or private, and the requests with an authorization
+// or cookie header (or all the requests when the server drops the cookies, see AsyncWebServer::dropHeader()).
+// The cached responses use at most maxBytes: the least recently used ones are evicted to make room for new ones.
+// The headers added by the middlewares running after this one are cached with the response, including their header
+// blocks (i.e. the CORS headers, whose Vary is honored).
+class AsyncCacheMiddleware : public AsyncMiddleware {
+public:
+  void setMaxBytes(size_t bytes) {
+    _maxBytes = bytes;
+    _evict(0);
+  }
+  // time to live of the cached responses, unless set for their URL (a lower max-age in their cache-control is used instead)
+  void setTTL(uint32_t seconds) {
+    _ttl = seconds * 1000;
+  }
+  // time to live of the responses cached for the URLs starting with prefix (the longest prefix applies), 0 to not cache them
+  void setTTL(const char *prefix, uint32_t seconds);
+  // removes the cached responses, i.e. when the data they were built from changed
+  void clear() {
+    _entries.clear();
+    _bytes = 0;
+  }
+  // memory used by the cached responses
+  size_t bytes() const {
+    return _bytes;
+  }
+
+  void run(AsyncWebServerRequest *request, ArMiddlewareNext next);
+
+private:
+  struct Entry {
+    uint32_t hash;  // of the URL and the query parameters
+    String url;
+    std::vector<String> vary;  // request headers the response varies on
+    uint32_t varyHash;         // of their values
+    uint32_t stored;           // millis()
+    uint32_t ttl;              // ms
+    size_t bytes;
+    std::shared_ptr<const String> headers;
+    std::shared_ptr<const String> content;
+  };
+
+  std::list<Entry> _entries;  // most recently used first
+  std::vector<std::pair<String, uint32_t>> _ttls;
+  size_t _maxBytes = ASYNCWEBSERVER_CACHE_BYTES;
+  uint32_t _ttl = ASYNCWEBSERVER_CACHE_TTL * 1000;
+  size_t _bytes = 0;
+
+  uint32_t _ttlOf(const String &url) const;
+  // evicts the least recently used responses until bytes more fit
+  void _evict(size_t bytes);
+  void _store(AsyncWebServerRequest *request, AsyncWebServerResponse *response, uint32_t hash);
+};
+
+// Request coalescing Middleware (single flight)
+// While a GET request is being answered (i.e. its handler paused it to build the response asynchronously), the identical
+// requests arriving meanwhile (same URL, query parameters and cookies) are paused instead of calling the handler again: they
+// are all answered with the response of the first one, whose headers and content are rendered once and shared.
+// If the first request is deleted without response, one of the waiting requests runs its handler for the others.
+// Only a 200 response is shared, with the requests having the same values for the headers listed in its Vary header.
+// Otherwise (or if it cannot be shared: streamed, chunked, templates...), the waiting requests all run their handler.
+// The requests with an authorization, conditional (If-*) or Range header are not coalesced, nor any request if the server
+// drops the Cookie header (see AsyncWebServer::dropHeader()). The response is not shared if it varies on a dropped header.
+class AsyncCoalesceMiddleware : public AsyncMiddleware {
+public:
+  void run(AsyncWebServerRequest *request, ArMiddlewareNext next);
+
+private:
+  struct Follower {
+    AsyncWebServerRequestPtr request;
+    ArMiddlewareNext next;
+  };
+
+  struct Flight {
+    AsyncWebServerRequest *leader;
+    uint32_t hash;  // of the URL, the query parameters and the cookies
+    String url;
+    String cookie;
+    std::vector<Follower> followers;
+  };
+
+#ifdef ESP32
+  // the response of a leader can be sent from another task
+  std::mutex _lock;
+#endif
+  std::list<Flight> _flights;
+
+  void _lead(AsyncWebServerRequest *request, uint32_t hash, std::vector<Follower> followers);
+  void _land(AsyncWebServerRequest *leader, AsyncWebServerResponse *response);
+};
+
+typedef enum {
+  ROUTE_ANY = 0,    // any URL, canHandle() decides
+  ROUTE_EXACT,      // the URL is the path
+  ROUTE_SEGMENT,    // the URL is the path or is below it (path/...)
+  ROUTE_PREFIX,     // the URL starts with the path
+  ROUTE_EXTENSION,  // the URL ends with the path
+} AsyncRouteKind;
+
+// URLs and methods a handler (or a rewrite) can handle, used by the server to only check the handlers and rewrites which can match a request
+struct AsyncWebRoute {
+  AsyncRouteKind kind = ROUTE_ANY;
+  const char *path = nullptr;  // not null-terminated, owned by the handler or rewrite
+  size_t length = 0;
+  WebRequestMethodComposite methods = HTTP_ANY;
+
+  AsyncWebRoute() = default;
+  AsyncWebRoute(AsyncRouteKind kind, const char *path, size_t length, WebRequestMethodComposite methods)
+    : kind(kind), path(path), length(length), methods(methods) {}
+  // true if the URL matches the route (the methods are not checked)
+  bool matches(const String &url) const;
 };
 
 /*
@@ -975,6 +1486,16 @@ public:
   virtual bool match(AsyncWebServerRequest *request) {
     return from() == request->url() && filter(request);
   }
+  /**
+   * @brief URLs this rewrite can match, used by the server to index the rewrites.
+   * Subclasses overriding match() can override this to be looked up by path instead of being checked for all the requests:
+   * match() is still called, only for the requests whose URL matches the route.
+   *
+   * @return AsyncWebRoute a route of kind ROUTE_ANY (default), ROUTE_EXACT or ROUTE_PREFIX
+   */
+  virtual AsyncWebRoute route() const {
+    return AsyncWebRoute();
+  }
 };
 
 /*
@@ -986,6 +1507,7 @@ protected:
   ArRequestFilterFunction _filter = nullptr;
   AsyncAuthenticationMiddleware *_authMiddleware = nullptr;
   bool _skipServerMiddlewares = false;
+  AsyncSendPriority _sendPriority = SEND_PRIORITY_NORMAL;
 
 public:
   AsyncWebHandler() {}
@@ -1006,12 +1528,30 @@ public:
   bool mustSkipServerMiddlewares() const {
     return _skipServerMiddlewares;
   }
+  // priority class of the responses of this handler when the server send scheduler is enabled
+  AsyncWebHandler &setSendPriority(AsyncSendPriority priority) {
+    _sendPriority = priority;
+    return *this;
+  }
+  AsyncSendPriority sendPriority() const {
+    return _sendPriority;
+  }
   bool filter(AsyncWebServerRequest *request) {
     return _filter == NULL || _filter(request);
   }
   virtual bool canHandle(AsyncWebServerRequest *request __attribute__((unused))) const {
     return false;
   }
+  /**
+   * @brief Route of the handler: the server only calls filter() and canHandle() for the requests matching it.
+   * The routes are indexed when the first request comes after a handler was added or removed,
+   * so a handler must not change its route once it receives requests.
+   *
+   * @return AsyncWebRoute a route of kind ROUTE_ANY (default) to be checked for all the requests
+   */
+  virtual AsyncWebRoute route() const {
+    return AsyncWebRoute();
+  }
   virtual void handleRequest(__unused AsyncWebServerRequest *request) {}
   virtual void handleUpload(
     __unused AsyncWebServerRequest *request, __unused const String &filename, __unused size_t index, __unused uint8_t *data, __unused size_t len,
@@ -1049,6 +1589,7 @@ protected:
   size_t _ackedLength;
   size_t _writtenLength;
   WebResponseState _state;
+  std::vector<std::shared_ptr<const String>> _headerBlocks;
 
   static bool headerMustBePresentOnce(const String &name);
 
@@ -1063,10 +1604,16 @@ public:
     return _code;
   }
   void setContentLength(size_t len);
+  size_t contentLength() const {
+    return _contentLength;
+  }
   void setContentType(const String &type) {
     setContentType(type.c_str());
   }
   void setContentType(const char *type);
+  const String &contentType() const {
+    return _contentType;
+  }
   bool addHeader(AsyncWebHeader &&header, bool replaceExisting = true);
   bool addHeader(const AsyncWebHeader &header, bool replaceExisting = true) {
     return header && addHeader(header.name(), header.value(), replaceExisting);
@@ -1087,6 +1634,17 @@ public:
   const std::list<AsyncWebHeader> &getHeaders() const {
     return _headers;
   }
+  const std::vector<std::shared_ptr<const String>> &getHeaderBlocks() const {
+    return _headerBlocks;
+  }
+  // adds headers rendered beforehand ("name: value\r\n" lines), sent after the other ones.
+  // The block is shared with the other responses using it (i.e. the CORS headers of AsyncCorsMiddleware).
+  // Its headers are not seen by getHeader(), removeHeader() nor addHeader(): they cannot be inspected nor replaced.
+  void addHeaderBlock(std::shared_ptr<const String> block) {
+    if (block) {
+      _headerBlocks.emplace_back(std::move(block));
+    }
+  }
 
 #ifndef ESP8266
   [[deprecated("Use instead: _assembleHead(String& buffer, uint8_t version)")]]
@@ -1104,6 +1662,16 @@ public:
   virtual bool _sourceValid() const;
   virtual void _respond(AsyncWebServerRequest *request);
   virtual size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
+  // computes a hash of the whole content (used to generate ETags).
+  // returns false if the content is not known before being sent (streamed, chunked, templates...)
+  virtual bool _contentHash(uint32_t &hash __attribute__((unused))) {
+    return false;
+  }
+  // prints the whole content (used to cache responses).
+  // returns false if the content is not known before being sent (streamed, chunked, templates...)
+  virtual bool _contentPrint(Print &out __attribute__((unused))) {
+    return false;
+  }
 };
 
 /*
@@ -1119,9 +1687,47 @@ class AsyncWebServer : public AsyncMiddlewareChain {
 protected:
   AsyncServer _server;
   std::list<std::shared_ptr<AsyncWebRewrite>> _rewrites;
-  std::list<std::unique_ptr<AsyncWebHandler>> _handlers;
+  std::list<std::shared_ptr<AsyncWebHandler>> _handlers;
   AsyncCallbackWebHandler *_catchAllHandler;
 
+  // fair send scheduler: deficit round robin between the responses being sent
+  struct SendFlow {
+    AsyncWebServerRequest *request;
+    AsyncSendPriority priority;
+    size_t deficit;  // bytes still allowed in the current round
+    bool waiting;    // has used its share of the current round
+  };
+  bool _sendScheduler = false;
+  bool _sendKicking = false;
+  size_t _sendQuantum[SEND_PRIORITY_MAX] = {4 * ASYNCWEBSERVER_SEND_QUANTUM, 2 * ASYNCWEBSERVER_SEND_QUANTUM, ASYNCWEBSERVER_SEND_QUANTUM};
+  uint32_t _sendRoundStart = 0;
+  std::list<SendFlow> _sendFlows;
+  SendFlow *_findSendFlow(AsyncWebServerRequest *request);
+  void _nextSendRound(AsyncWebServerRequest *current);
+
+  std::list<std::pair<fs::FS *, AwsFileMapper>> _fileMappers;
+
+  // headers stored in the requests (see keepHeader()), sorted by hash. Empty if all the headers are stored
+  struct HeaderRule {
+    uint32_t hash;  // of the lowercase name
+    String name;
+    bool keep;
+    bool required;  // needed by the server: always kept
+  };
+  std::vector<HeaderRule> _headerRules;
+  bool _keepListedHeaders = false;
+  HeaderRule *_findHeaderRule(const char *name, size_t len, uint32_t hash);
+  void _addHeaderRule(const char *name, bool keep, bool required);
+
+  // routing snapshot of the handlers and rewrites, replaced on the next request when they change.
+  // _handlers, _rewrites and _routesChanged are changed with _routesLock held, from any task
+  std::atomic<AsyncWebRouter *> _routes{nullptr};
+  std::atomic<bool> _routesChanged{true};
+#ifdef ESP32
+  std::mutex _routesLock;
+#endif
+  AsyncWebRouter *_acquireRoutes();
+
 public:
   AsyncWebServer(uint16_t port);
   ~AsyncWebServer();
@@ -1157,8 +1763,9 @@ public:
 
   /**
      * @brief add url rewrite rule
+     * the rewrites are looked up by path: exact paths in a hash table, and paths ending with '*' (prefixes) in a tree
      *
-     * @param from
+     * @param from path of the request, or prefix of the paths if it ends with '*'
      * @param to
      * @return AsyncWebRewrite&
      */
@@ -1184,6 +1791,8 @@ public:
      */
   bool removeRewrite(const char *from, const char *to);
 
+  // the handlers and rewrites can be added and removed from any task, also while the server runs:
+  // the requests in progress keep the handlers they use, a removed handler is deleted after them
   AsyncWebHandler &addHandler(AsyncWebHandler *handler);
   bool removeHandler(AsyncWebHandler *handler);
 
@@ -1196,6 +1805,8 @@ public:
   );
 
   AsyncStaticWebHandler &serveStatic(const char *uri, fs::FS &fs, const char *path, const char *cache_control = NULL);
+  // serve the files embedded at build time by tools/webbundle.py
+  AsyncBundleWebHandler &serveBundle(const char *uri, const AsyncBundle &bundle);
 
   void onNotFound(ArRequestHandlerFunction fn);   // called when handler is not assigned
   void onFileUpload(ArUploadHandlerFunction fn);  // handle file uploads
@@ -1205,7 +1816,51 @@ public:
 
   void reset();  // remove all writers and handlers, with onNotFound/onFileUpload/onRequestBody
 
+  /**
+   * @brief Share the send bandwidth between the responses being sent instead of letting each connection fill its whole socket buffer.
+   * Each response gets a quantum of bytes per round (deficit round robin) according to the priority class of its handler
+   * (see AsyncWebHandler::setSendPriority), so that a large download cannot monopolize the CPU and the TCP buffers
+   * while small API responses are waiting. Applies to file, stream, callback, chunked and PROGMEM responses.
+   *
+   * @param enable true to enable the scheduler (disabled by default)
+   */
+  void setSendScheduler(bool enable);
+  /**
+   * @brief Set the number of bytes a response of the given priority class can send per round
+   */
+  void setSendQuantum(AsyncSendPriority priority, size_t bytes);
+
+  /**
+   * @brief Declare that the files of a file system can be memory-mapped.
+   * beginResponse(fs, path) then serves the files the mapper accepts with an AsyncMappedResponse,
+   * without copying them through File::read(), and with support for range requests.
+   *
+   * @param fs file system, which must outlive the server
+   * @param mapper maps a file, nullptr to remove the mapper of this file system
+   */
+  void setFileMapper(fs::FS &fs, AwsFileMapper mapper);
+  bool _mapFile(fs::FS &fs, const String &path, AsyncMappedRegion &region);
+
+  /**
+   * @brief Choose the headers stored in the requests: all of them by default.
+   * The parser checks each header against this policy before storing it: once a header is kept with keepHeader(),
+   * only the kept headers are stored, and the headers dropped with dropHeader() are never stored
+   * (i.e. the cookies or client hints that the application never reads, which cost memory per request).
+   * The headers used by the server itself (host, content-type, content-length, authorization, websocket, CORS,
+   * cache and range headers...) are always stored.
+   *
+   * @param name header name, case-insensitive
+   */
+  void keepHeader(const char *name);
+  void dropHeader(const char *name);
+  // for internal use: whether the request header named by the len first characters of name is stored
+  bool _storeHeader(const char *name, size_t len);
+
   void _handleDisconnect(AsyncWebServerRequest *request);
+  void _sendAttach(AsyncWebServerRequest *request, AsyncSendPriority priority);
+  void _sendDetach(AsyncWebServerRequest *request);
+  size_t _sendGrant(AsyncWebServerRequest *request, size_t space, bool idle);
+  void _sendConsume(AsyncWebServerRequest *request, size_t len);
   void _attachHandler(AsyncWebServerRequest *request);
   void _rewriteRequest(AsyncWebServerRequest *request);
 };
@@ -1239,6 +1894,39 @@ public:
   }
 };
 
+// Content types by file extension, used to set the content type of the file responses.
+// Lookups are done in a hash table, and the applications can add their own types:
+// AsyncMimeTypes::Instance().add(".wasm", "application/wasm");
+class AsyncMimeTypes {
+  struct Entry {
+    uint32_t hash;
+    const char *extension;
+    const char *contentType;
+  };
+  std::vector<Entry> _table;  // open addressing, size is a power of 2
+  size_t _count = 0;
+
+  AsyncMimeTypes();
+  static uint32_t _hash(const char *extension);
+  void _insert(const Entry &entry);
+
+public:
+  AsyncMimeTypes(AsyncMimeTypes const &) = delete;
+  AsyncMimeTypes &operator=(AsyncMimeTypes const &) = delete;
+
+  // add or replace the content type of an extension (including the dot), the strings must remain valid
+  void add(const char *extension, const char *contentType);
+  // content type of the extension (including the dot), nullptr if unknown
+  const char *find(const char *extension) const;
+  // content type of a file, text/plain if unknown
+  const char *get(const char *path) const;
+
+  static AsyncMimeTypes &Instance() {
+    static AsyncMimeTypes instance;
+    return instance;
+  }
+};
+
 #include "AsyncEventSource.h"
 #include "AsyncWebSocket.h"
 #include "WebHandlerImpl.h"
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+#ifndef HASHPRINT_H
+#define HASHPRINT_H
+
+#include <Print.h>
+
+// Computes a 32-bit FNV-1a hash of everything printed to it.
+// It is not a cryptographic hash: it is only meant to detect content changes (i.e. ETags).
+class HashPrint : public Print {
+public:
+  static constexpr uint32_t OFFSET_BASIS = 2166136261UL;
+  static constexpr uint32_t PRIME = 16777619UL;
+
+  static uint32_t hash(const uint8_t *data, size_t len, uint32_t hash = OFFSET_BASIS) {
+    while (len--) {
+      hash = (hash ^ *data++) * PRIME;
+    }
+    return hash;
+  }
+
+  explicit HashPrint(uint32_t hash = OFFSET_BASIS) : _hash(hash) {}
+  size_t write(uint8_t c) override {
+    _hash = (_hash ^ c) * PRIME;
+    return 1;
+  }
+  size_t write(const uint8_t *buffer, size_t size) override {
+    _hash = hash(buffer, size, _hash);
+    return size;
+  }
+  uint32_t hash() const {
+    return _hash;
+  }
+
+private:
+  uint32_t _hash;
+};
+#endif
@@ -4,23 +4,33 @@
 #include "WebAuthentication.h"
 #include <ESPAsyncWebServer.h>
 
-AsyncMiddlewareChain::~AsyncMiddlewareChain() {
-  for (AsyncMiddleware *m : _middlewares) {
-    if (m->_freeOnRemoval) {
-      delete m;
-    }
-  }
-}
+#include <time.h>
+
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+uint32_t AsyncMiddlewareChain::_revision = 1;
+
+AsyncMiddlewareChain::~AsyncMiddlewareChain() {}
+
+static void doNotDelete(AsyncMiddleware *) {}
 
 void AsyncMiddlewareChain::addMiddleware(ArMiddlewareCallback fn) {
   AsyncMiddlewareFunction *m = new AsyncMiddlewareFunction(fn);
   m->_freeOnRemoval = true;
-  _middlewares.emplace_back(m);
+  addMiddleware(m);
 }
 
 void AsyncMiddlewareChain::addMiddleware(AsyncMiddleware *middleware) {
   if (middleware) {
-    _middlewares.emplace_back(middleware);
+    if (middleware->_freeOnRemoval) {
+      _middlewares.emplace_back(middleware);
+    } else {
+      _middlewares.emplace_back(middleware, doNotDelete);
+    }
+    _revision++;
   }
 }
 
@@ -31,41 +41,38 @@ void AsyncMiddlewareChain::addMiddlewares(std::vector<AsyncMiddleware *> middlew
 }
 
 bool AsyncMiddlewareChain::removeMiddleware(AsyncMiddleware *middleware) {
-  // remove all middlewares from _middlewares vector being equal to middleware, delete them having _freeOnRemoval flag to true and resize the vector.
+  // remove all middlewares from _middlewares vector being equal to middleware: the ones having _freeOnRemoval flag to true
+  // are deleted once the compiled chains of the paused requests do not use them anymore
   const size_t size = _middlewares.size();
   _middlewares.erase(
     std::remove_if(
       _middlewares.begin(), _middlewares.end(),
-      [middleware](AsyncMiddleware *m) {
-        if (m == middleware) {
-          if (m->_freeOnRemoval) {
-            delete m;
-          }
-          return true;
-        }
-        return false;
+      [middleware](const std::shared_ptr<AsyncMiddleware> &m) {
+        return m.get() == middleware;
       }
     ),
     _middlewares.end()
   );
-  return size != _middlewares.size();
+  if (size == _middlewares.size()) {
+    return false;
+  }
+  _revision++;
+  return true;
 }
 
-void AsyncMiddlewareChain::_runChain(AsyncWebServerRequest *request, ArMiddlewareNext finalizer) {
-  if (!_middlewares.size()) {
-    return finalizer();
-  }
-  ArMiddlewareNext next;
-  std::list<AsyncMiddleware *>::iterator it = _middlewares.begin();
-  next = [this, &next, &it, request, finalizer]() {
-    if (it == _middlewares.end()) {
-      return finalizer();
+std::shared_ptr<const std::vector<std::shared_ptr<AsyncMiddleware>>> AsyncMiddlewareChain::_compileChain(const AsyncMiddlewareChain *parent) {
+  if (!_chain || _chainRevision != _revision || _chainParent != parent) {
+    auto chain = std::make_shared<std::vector<std::shared_ptr<AsyncMiddleware>>>();
+    if (parent) {
+      chain->reserve(parent->_middlewares.size() + _middlewares.size());
+      chain->insert(chain->end(), parent->_middlewares.begin(), parent->_middlewares.end());
     }
-    AsyncMiddleware *m = *it;
-    it++;
-    return m->run(request, next);
-  };
-  return next();
+    chain->insert(chain->end(), _middlewares.begin(), _middlewares.end());
+    _chain = std::move(chain);
+    _chainParent = parent;
+    _chainRevision = _revision;
+  }
+  return _chain;
 }
 
 void AsyncAuthenticationMiddleware::setUsername(const char *username) {
@@ -228,22 +235,375 @@ void AsyncLoggingMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNex
   }
 }
 
-void AsyncCorsMiddleware::addCORSHeaders(AsyncWebServerResponse *response) {
-  response->addHeader(asyncsrv::T_CORS_ACAO, _origin.c_str());
+AsyncAccessLogMiddleware::~AsyncAccessLogMiddleware() {
+  end();
+}
+
+bool AsyncAccessLogMiddleware::begin(Print &output, AsyncAccessLogFormat format, size_t records) {
+  end();
+  size_t capacity = 1;
+  while (capacity < records) {
+    capacity *= 2;
+  }
+  _ring = new (std::nothrow) AsyncAccessLogRecord[capacity];
+  if (!_ring) {
+#ifdef ESP32
+    log_e("Failed to allocate");
+#endif
+    return false;
+  }
+  _mask = capacity - 1;
+  _out = &output;
+  _format = format;
+  _head = 0;
+  _tail = 0;
+  _dropped = 0;
+  _droppedLogged = 0;
+  _running = true;
+#ifdef ESP32
+  TaskHandle_t task = nullptr;
+  if (xTaskCreate(_taskLoop, "async_log", ASYNCWEBSERVER_ACCESS_LOG_TASK_STACK, this, ASYNCWEBSERVER_ACCESS_LOG_TASK_PRIORITY, &task) != pdPASS) {
+    log_e("Failed to create the access log task");
+    _running = false;
+    while (_writers.load()) {
+      delay(1);
+    }
+    delete[] _ring;
+    _ring = nullptr;
+    return false;
+  }
+  _task = task;
+#endif
+  return true;
+}
+
+void AsyncAccessLogMiddleware::end() {
+  if (!_running) {
+    return;
+  }
+  _running = false;
+  // wait for the run() calls writing a record: they saw _running before it was cleared
+  while (_writers.load()) {
+    delay(1);
+  }
+#ifdef ESP32
+  // the task writes the pending records, then clears _task and exits
+  TaskHandle_t task = static_cast<TaskHandle_t>(_task.load());
+  if (task) {
+    xTaskNotifyGive(task);
+    while (_task.load()) {
+      delay(1);
+    }
+  }
+#else
+  flush();
+#endif
+  delete[] _ring;
+  _ring = nullptr;
+}
+
+#ifdef ESP32
+void AsyncAccessLogMiddleware::_taskLoop(void *self) {
+  AsyncAccessLogMiddleware *log = static_cast<AsyncAccessLogMiddleware *>(self);
+  while (log->_running) {
+    log->flush();
+    // woken up by run() for each record, or by end()
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+  log->flush();
+  log->_task = nullptr;
+  vTaskDelete(nullptr);
+}
+#endif
+
+void AsyncAccessLogMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
+  if (!_running) {
+    return next();
+  }
+  const uint32_t start = millis();
+  next();
+  const uint32_t duration = millis() - start;
+
+  // end() may have been called meanwhile (i.e. from loop()): the ring is kept until _writers drops to 0
+  _writers++;
+  if (!_running) {
+    _writers--;
+    return;
+  }
+  const size_t head = _head.load(std::memory_order_relaxed);
+  if (head - _tail.load(std::memory_order_acquire) > _mask) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    _writers--;
+    return;
+  }
+  AsyncAccessLogRecord &record = _ring[head & _mask];
+  const AsyncWebServerResponse *response = request->getResponse();
+  record.time = time(nullptr);
+  const IPAddress ip = request->client()->remoteIP();
+  record.ipv6 = false;
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+  if (ip.type() == IPv6) {
+    record.ipv6 = true;
+    for (int i = 0; i < 16; i++) {
+      record.ip[i] = ip[i];
+    }
+  }
+#endif
+  if (!record.ipv6) {
+    const uint32_t v4 = (uint32_t)ip;
+    for (int i = 0; i < 4; i++) {
+      record.ip[i] = (v4 >> (8 * i)) & 0xFF;
+    }
+  }
+  record.bytes = response ? response->contentLength() : 0;
+  record.duration = duration;
+  record.method = request->methodToString();
+  record.status = response ? response->code() : 0;
+  record.version = request->version();
+  const String &url = request->url();
+  record.pathLength = url.length() < ASYNCWEBSERVER_ACCESS_LOG_PATH ? url.length() : ASYNCWEBSERVER_ACCESS_LOG_PATH;
+  memcpy(record.path, url.c_str(), record.pathLength);
+  _head.store(head + 1, std::memory_order_release);
+#ifdef ESP32
+  TaskHandle_t task = static_cast<TaskHandle_t>(_task.load());
+  if (task) {
+    xTaskNotifyGive(task);
+  }
+#endif
+  _writers--;
+}
+
+size_t AsyncAccessLogMiddleware::flush(size_t max) {
+  if (!_ring) {
+    return 0;
+  }
+  size_t count = 0;
+  size_t tail = _tail.load(std::memory_order_relaxed);
+  const size_t head = _head.load(std::memory_order_acquire);
+  while (tail != head && count < max) {
+    _write(_ring[tail & _mask]);
+    _tail.store(++tail, std::memory_order_release);
+    count++;
+  }
+  const uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+  if (dropped != _droppedLogged) {
+    if (_format == ACCESS_LOG_JSON) {
+      _out->printf("{\"dropped\":%lu}\n", (unsigned long)(dropped - _droppedLogged));
+    } else {
+      _out->printf("# %lu records dropped\n", (unsigned long)(dropped - _droppedLogged));
+    }
+    _droppedLogged = dropped;
+  }
+  return count;
+}
+
+void AsyncAccessLogMiddleware::_write(const AsyncAccessLogRecord &record) {
+  // the whole line is formatted in a buffer and written at once
+  char line[128 + 2 * ASYNCWEBSERVER_ACCESS_LOG_PATH];
+  char ip[40];
+  if (record.ipv6) {
+    // 8 groups, without zero compression
+    const uint8_t *a = record.ip;
+    snprintf(
+      ip, sizeof(ip), "%x:%x:%x:%x:%x:%x:%x:%x", (a[0] << 8) | a[1], (a[2] << 8) | a[3], (a[4] << 8) | a[5], (a[6] << 8) | a[7], (a[8] << 8) | a[9],
+      (a[10] << 8) | a[11], (a[12] << 8) | a[13], (a[14] << 8) | a[15]
+    );
+  } else {
+    snprintf(ip, sizeof(ip), "%u.%u.%u.%u", record.ip[0], record.ip[1], record.ip[2], record.ip[3]);
+  }
+  char status[8] = "-";
+  if (record.status) {
+    snprintf(status, sizeof(status), "%u", record.status);
+  }
+  int len;
+  if (_format == ACCESS_LOG_JSON) {
+    // the path is escaped for JSON
+    char path[2 * ASYNCWEBSERVER_ACCESS_LOG_PATH + 1];
+    size_t n = 0;
+    for (size_t i = 0; i < record.pathLength; i++) {
+      const char c = record.path[i];
+      if (c == '"' || c == '\\') {
+        path[n++] = '\\';
+        path[n++] = c;
+      } else {
+        path[n++] = (unsigned char)c < 0x20 ? '?' : c;
+      }
+    }
+    path[n] = 0;
+    len = snprintf(
+      line, sizeof(line), "{\"time\":%lu,\"ip\":\"%s\",\"method\":\"%s\",\"path\":\"%s\",\"status\":%s,\"bytes\":%lu,\"ms\":%lu}\n",
+      (unsigned long)record.time, ip, record.method, path, record.status ? status : "null", (unsigned long)record.bytes, (unsigned long)record.duration
+    );
+  } else {
+    time_t t = record.time;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char date[32];
+    strftime(date, sizeof(date), "%d/%b/%Y:%H:%M:%S +0000", &tm);
+    len = snprintf(
+      line, sizeof(line), "%s - - [%s] \"%s %.*s HTTP/1.%u\" %s %lu\n", ip, date, record.method, (int)record.pathLength, record.path, record.version, status,
+      (unsigned long)record.bytes
+    );
+  }
+  if (len > 0) {
+    _out->write((const uint8_t *)line, (size_t)len < sizeof(line) ? len : sizeof(line) - 1);
+  }
+}
+
+void AsyncCorsMiddleware::addOrigin(const char *origin) {
+  Origin entry = {origin, HashPrint::hash(reinterpret_cast<const uint8_t *>(origin), strlen(origin)), nullptr};
+  if (_findOrigin(entry.origin)) {
+    return;
+  }
+  _origins.emplace_back(std::move(entry));
+  // half-full table at most
+  size_t size = 4;
+  while (size < 2 * _origins.size()) {
+    size *= 2;
+  }
+  _originSlots.assign(size, 0);
+  for (size_t i = 0; i < _origins.size(); i++) {
+    size_t slot = _origins[i].hash & (size - 1);
+    while (_originSlots[slot]) {
+      slot = (slot + 1) & (size - 1);
+    }
+    _originSlots[slot] = i + 1;
+  }
+  _render();
+}
+
+void AsyncCorsMiddleware::clearOrigins() {
+  _origins.clear();
+  _originSlots.clear();
+  _render();
+}
+
+AsyncCorsMiddleware::Origin *AsyncCorsMiddleware::_findOrigin(const String &origin) {
+  if (_originSlots.empty()) {
+    return nullptr;
+  }
+  const size_t mask = _originSlots.size() - 1;
+  const uint32_t hash = HashPrint::hash(reinterpret_cast<const uint8_t *>(origin.c_str()), origin.length());
+  for (size_t slot = hash & mask; _originSlots[slot]; slot = (slot + 1) & mask) {
+    Origin &entry = _origins[_originSlots[slot] - 1];
+    if (entry.hash == hash && entry.origin == origin) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+void AsyncCorsMiddleware::_render() {
+  // rendered once for all the responses: only access-control-allow-origin is added per response when origins were added
+  String block;
+  block.reserve(200 + _origin.length() + _methods.length() + _headers.length());
+  const auto line = [&block](const char *name, const char *value) {
+    block.concat(name);
+    block.concat(": ");
+    block.concat(value);
+    block.concat(asyncsrv::T_rn);
+  };
+  if (_origins.empty()) {
+    line(asyncsrv::T_CORS_ACAO, _origin.c_str());
+  } else {
+    // the response depends on the origin of the request
+    line(asyncsrv::T_Vary, asyncsrv::T_CORS_O);
+  }
+  line(asyncsrv::T_CORS_ACAM, _methods.c_str());
+  line(asyncsrv::T_CORS_ACAH, _headers.c_str());
+  line(asyncsrv::T_CORS_ACAC, _credentials ? asyncsrv::T_TRUE : asyncsrv::T_FALSE);
+  line(asyncsrv::T_CORS_ACMA, String(_maxAge).c_str());
+  _block = std::make_shared<const String>(std::move(block));
+
+  // the preflight responses are rendered again when needed, the ones being sent keep the previous bytes
+  _preflight = nullptr;
+  for (Origin &entry : _origins) {
+    entry.preflight = nullptr;
+  }
+}
+
+std::shared_ptr<const String> AsyncCorsMiddleware::_renderPreflight(const char *origin) const {
+  AsyncPrerenderedResponse response(204);
+  if (origin) {
+    response.addHeader(asyncsrv::T_CORS_ACAO, origin);
+  }
+  response.addHeader(asyncsrv::T_Connection, asyncsrv::T_close);
+  response.addHeaderBlock(_block);
+  return response.render();
+}
+
+void AsyncCorsMiddleware::_addHeaders(AsyncWebServerResponse *response) const {
+  // the block would duplicate the headers already set (i.e. by the handler): add them one by one, replacing them
+  static const char *const names[] = {
+    asyncsrv::T_CORS_ACAO, asyncsrv::T_CORS_ACAM, asyncsrv::T_CORS_ACAH, asyncsrv::T_CORS_ACAC, asyncsrv::T_CORS_ACMA, asyncsrv::T_Vary,
+  };
+  bool present = false;
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]) && !present; i++) {
+    present = response->getHeader(names[i]) != nullptr;
+  }
+  if (!present) {
+    response->addHeaderBlock(_block);
+    return;
+  }
+  if (_origins.empty()) {
+    response->addHeader(asyncsrv::T_CORS_ACAO, _origin.c_str());
+  } else {
+    const AsyncWebHeader *vary = response->getHeader(asyncsrv::T_Vary);
+    if (!vary) {
+      response->addHeader(asyncsrv::T_Vary, asyncsrv::T_CORS_O);
+    } else {
+      String value = vary->value();
+      value.toLowerCase();
+      if (value.indexOf(asyncsrv::T_CORS_O) < 0) {
+        value = vary->value() + ", " + asyncsrv::T_CORS_O;
+        response->addHeader(asyncsrv::T_Vary, value.c_str());
+      }
+    }
+  }
   response->addHeader(asyncsrv::T_CORS_ACAM, _methods.c_str());
   response->addHeader(asyncsrv::T_CORS_ACAH, _headers.c_str());
   response->addHeader(asyncsrv::T_CORS_ACAC, _credentials ? asyncsrv::T_TRUE : asyncsrv::T_FALSE);
   response->addHeader(asyncsrv::T_CORS_ACMA, String(_maxAge).c_str());
 }
 
+void AsyncCorsMiddleware::addCORSHeaders(AsyncWebServerResponse *response) {
+  _addHeaders(response);
+}
+
+void AsyncCorsMiddleware::addCORSHeaders(AsyncWebServerRequest *request, AsyncWebServerResponse *response) {
+  if (_origins.empty()) {
+    _addHeaders(response);
+    return;
+  }
+  const AsyncWebHeader *header = request->getHeader(asyncsrv::T_CORS_O);
+  if (header && _findOrigin(header->value())) {
+    _addHeaders(response);
+    response->addHeader(asyncsrv::T_CORS_ACAO, header->value().c_str());
+  }
+}
+
 void AsyncCorsMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
   // Origin header ? => CORS handling
-  if (request->hasHeader(asyncsrv::T_CORS_O)) {
-    // check if this is a preflight request => handle it and return
+  const AsyncWebHeader *header = request->getHeader(asyncsrv::T_CORS_O);
+  if (header) {
+    // check if this is a preflight request => answer it with the rendered response and return
     if (request->method() == HTTP_OPTIONS) {
-      AsyncWebServerResponse *response = request->beginResponse(200);
-      addCORSHeaders(response);
-      request->send(response);
+      std::shared_ptr<const String> preflight;
+      if (_origins.empty()) {
+        if (!_preflight) {
+          _preflight = _renderPreflight(nullptr);
+        }
+        preflight = _preflight;
+      } else if (Origin *entry = _findOrigin(header->value())) {
+        if (!entry->preflight) {
+          entry->preflight = _renderPreflight(entry->origin.c_str());
+        }
+        preflight = entry->preflight;
+      } else {
+        request->send(403);
+        return;
+      }
+      request->send(new AsyncPrerenderedResponse(204, preflight));
       return;
     }
 
@@ -251,7 +611,7 @@ void AsyncCorsMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext n
     next();
     AsyncWebServerResponse *response = request->getResponse();
     if (response) {
-      addCORSHeaders(response);
+      addCORSHeaders(request, response);
     }
 
   } else {
@@ -260,32 +620,636 @@ void AsyncCorsMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext n
   }
 }
 
-bool AsyncRateLimitMiddleware::isRequestAllowed(uint32_t &retryAfterSeconds) {
-  uint32_t now = millis();
+void AsyncRateLimitMiddleware::setMaxClients(size_t clients) {
+  _maxClients = 1;
+  while (_maxClients < clients) {
+    _maxClients *= 2;
+  }
+  _clear();
+}
 
-  while (!_requestTimes.empty() && _requestTimes.front() <= now - _windowSizeMillis) {
-    _requestTimes.pop_front();
+AsyncRateLimitMiddleware::Bucket *AsyncRateLimitMiddleware::_bucket(uint32_t key) {
+  if (_buckets.empty()) {
+    _buckets.resize(_maxClients);
+    if (_buckets.size() != _maxClients) {
+#ifdef ESP32
+      log_e("Failed to allocate");
+#endif
+      return nullptr;
+    }
   }
 
-  _requestTimes.push_back(now);
+  // linear probing over a few slots: the key, else a free slot, else the least recently seen one
+  const uint32_t now = millis() | 1;
+  const size_t mask = _buckets.size() - 1;
+  const size_t probes = _buckets.size() < 8 ? _buckets.size() : 8;
+  uint32_t hash = key * 2654435761UL;
+  size_t index = (hash ^ (hash >> 16)) & mask;
+  Bucket *victim = nullptr;
+  for (size_t i = 0; i < probes; i++, index = (index + 1) & mask) {
+    Bucket &b = _buckets[index];
+    if (b.lastSeen && b.key == key) {
+      return &b;
+    }
+    if (!victim || (victim->lastSeen && (!b.lastSeen || now - b.lastSeen > now - victim->lastSeen))) {
+      victim = &b;
+    }
+  }
+  victim->key = key;
+  victim->lastSeen = 0;  // full, see _take()
+  return victim;
+}
 
-  if (_requestTimes.size() > _maxRequests) {
-    _requestTimes.pop_front();
-    retryAfterSeconds = (_windowSizeMillis - (now - _requestTimes.front())) / 1000 + 1;
+bool AsyncRateLimitMiddleware::_take(Bucket *bucket, uint32_t &remaining, uint32_t &resetSeconds, uint32_t &retryAfterSeconds) {
+  if (!_maxRequests) {
+    remaining = resetSeconds = 0;
+    retryAfterSeconds = _windowSizeMillis / 1000 + 1;
     return false;
   }
+  if (!bucket) {
+    // no table: not limited
+    remaining = _maxRequests;
+    resetSeconds = retryAfterSeconds = 0;
+    return true;
+  }
+  const uint32_t now = millis() | 1;  // 0 marks the free slots
+  const uint64_t token = _windowSizeMillis;
+  const uint64_t full = token * _maxRequests;
 
+  if (bucket->lastSeen) {
+    // refill since the last request
+    bucket->level += (uint64_t)(now - bucket->lastSeen) * _maxRequests;
+    if (bucket->level > full) {
+      bucket->level = full;
+    }
+  } else {
+    bucket->level = full;
+  }
+  bucket->lastSeen = now;
+
+  const bool allowed = bucket->level >= token;
+  if (allowed) {
+    bucket->level -= token;
+    retryAfterSeconds = 0;
+  } else {
+    retryAfterSeconds = (token - bucket->level + _maxRequests - 1) / _maxRequests / 1000 + 1;
+  }
+  remaining = bucket->level / token;
+  resetSeconds = (full - bucket->level + _maxRequests - 1) / _maxRequests / 1000;
+  return allowed;
+}
+
+// default key of a client: its IPv4 address, or a hash of its IPv6 address
+static uint32_t clientKey(AsyncWebServerRequest *request) {
+  const IPAddress ip = request->client()->remoteIP();
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+  if (ip.type() == IPv6) {
+    HashPrint hash;
+    for (int i = 0; i < 16; i++) {
+      hash.write(ip[i]);
+    }
+    return hash.hash();
+  }
+#endif
+  return (uint32_t)ip;
+}
+
+bool AsyncRateLimitMiddleware::isRequestAllowed(uint32_t &retryAfterSeconds) {
+  uint32_t remaining, resetSeconds;
   retryAfterSeconds = 0;
-  return true;
+  return !_windowSizeMillis || _take(&_global, remaining, resetSeconds, retryAfterSeconds);
+}
+
+bool AsyncRateLimitMiddleware::isRequestAllowed(AsyncWebServerRequest *request, uint32_t &retryAfterSeconds) {
+  uint32_t remaining, resetSeconds;
+  retryAfterSeconds = 0;
+  return !_windowSizeMillis || _take(_bucket(_key ? _key(request) : clientKey(request)), remaining, resetSeconds, retryAfterSeconds);
 }
 
 void AsyncRateLimitMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
-  uint32_t retryAfterSeconds;
-  if (isRequestAllowed(retryAfterSeconds)) {
+  if (!_windowSizeMillis) {
+    return next();
+  }
+  uint32_t remaining, resetSeconds, retryAfterSeconds;
+  if (_take(_bucket(_key ? _key(request) : clientKey(request)), remaining, resetSeconds, retryAfterSeconds)) {
     next();
   } else {
-    AsyncWebServerResponse *response = request->beginResponse(429);
-    response->addHeader(asyncsrv::T_retry_after, retryAfterSeconds);
-    request->send(response);
+    request->send(request->beginResponse(429));
+  }
+  AsyncWebServerResponse *response = request->getResponse();
+  if (response) {
+    response->addHeader(asyncsrv::T_RateLimit_Limit, (uint32_t)_maxRequests);
+    response->addHeader(asyncsrv::T_RateLimit_Remaining, remaining);
+    response->addHeader(asyncsrv::T_RateLimit_Reset, resetSeconds);
+    if (retryAfterSeconds) {
+      response->addHeader(asyncsrv::T_retry_after, retryAfterSeconds);
+    }
+  }
+}
+
+void AsyncConcurrencyLimitMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
+  if (_bypass && _bypass(request)) {
+    next();
+    return;
+  }
+
+  if (_inFlight >= (size_t)_limit) {
+    // shed: the device is saturated, better fail fast than let the request time out
+    _refused++;
+    if (!_refusal) {
+      AsyncPrerenderedResponse response(503);
+      response.addHeader(asyncsrv::T_retry_after, (long)_retryAfter);
+      response.addHeader(asyncsrv::T_Connection, asyncsrv::T_close);
+      _refusal = response.render();
+    }
+    request->send(new AsyncPrerenderedResponse(503, _refusal));
+    return;
+  }
+
+  _inFlight++;
+  const uint32_t start = millis();
+  request->_onFinish([this, start](AsyncWebServerRequest *, AsyncWebServerResponse *) {
+    _finish(millis() - start);
+  });
+  next();
+}
+
+void AsyncConcurrencyLimitMiddleware::_finish(uint32_t latency) {
+  // the limit only grows when it is in use: it would grow without bounds under a light load otherwise
+  const bool limited = _inFlight * 2 >= (size_t)_limit;
+  _inFlight--;
+  if (latency > _targetLatency) {
+    _limit = std::max((float)_minLimit, _limit * _backoff);
+  } else if (limited) {
+    _limit = std::min((float)_maxLimit, _limit + 1 / _limit);
+  }
+}
+
+bool AsyncETagMiddleware::matches(AsyncWebServerRequest *request, const String &etag) {
+  const AsyncWebHeader *inm = request->getHeader(asyncsrv::T_INM);
+  if (!inm) {
+    return false;
+  }
+  // If-None-Match: "a", W/"b", ... or *
+  // weak comparison: the W/ prefix is ignored
+  const String &value = inm->value();
+  const char *wanted = etag.c_str();
+  size_t wantedLen = etag.length();
+  if (wantedLen > 2 && wanted[0] == 'W' && wanted[1] == '/') {
+    wanted += 2;
+    wantedLen -= 2;
+  }
+  int start = 0;
+  int len = value.length();
+  while (start < len) {
+    int end = value.indexOf(',', start);
+    if (end < 0) {
+      end = len;
+    }
+    int first = start;
+    int last = end;
+    while (first < last && isspace(value[first])) {
+      first++;
+    }
+    while (last > first && isspace(value[last - 1])) {
+      last--;
+    }
+    if (last - first >= 2 && value[first] == 'W' && value[first + 1] == '/') {
+      first += 2;
+    }
+    if (last - first == 1 && value[first] == '*') {
+      return true;
+    }
+    if ((size_t)(last - first) == wantedLen && strncmp(value.c_str() + first, wanted, wantedLen) == 0) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+void AsyncETagMiddleware::_sendNotModified(AsyncWebServerRequest *request, const String &etag) {
+  AsyncWebServerResponse *notModified = request->beginResponse(304);
+  notModified->addHeader(asyncsrv::T_ETag, etag.c_str());
+  // a 304 must carry the caching headers the 200 would have had
+  AsyncWebServerResponse *response = request->getResponse();
+  if (response) {
+    for (const char *name : {asyncsrv::T_Cache_Control, asyncsrv::T_Last_Modified, asyncsrv::T_Vary}) {
+      const AsyncWebHeader *header = response->getHeader(name);
+      if (header) {
+        notModified->addHeader(name, header->value().c_str());
+      }
+    }
+  }
+  request->send(notModified);
+}
+
+void AsyncETagMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
+  if (!request->methodMatches(HTTP_GET)) {
+    next();
+    return;
+  }
+
+  String etag;
+  if (_version) {
+    String version = _version(request);
+    if (version.length()) {
+      etag.reserve(version.length() + 2);
+      etag.concat('"');
+      etag.concat(version);
+      etag.concat('"');
+      if (matches(request, etag)) {
+        // the client is up to date: do not even run the handler
+        _sendNotModified(request, etag);
+        return;
+      }
+    }
+  }
+
+  next();
+
+  // no response yet (request paused) or response not cacheable
+  AsyncWebServerResponse *response = request->getResponse();
+  if (!response || response->code() != 200) {
+    return;
+  }
+
+  const AsyncWebHeader *header = response->getHeader(asyncsrv::T_ETag);
+  if (header) {
+    // ETag set by the handler
+    etag = header->value();
+  } else if (etag.length()) {
+    response->addHeader(asyncsrv::T_ETag, etag.c_str());
+  } else {
+    uint32_t hash;
+    if (!response->_contentHash(hash)) {
+      return;
+    }
+    char buf[11];
+    snprintf(buf, sizeof(buf), "\"%08lx\"", (unsigned long)hash);
+    etag = buf;
+    response->addHeader(asyncsrv::T_ETag, etag.c_str());
+  }
+
+  if (matches(request, etag)) {
+    _sendNotModified(request, etag);
+  }
+}
+
+// appends what is printed to a String, up to its reserved length
+class StringPrint : public Print {
+public:
+  StringPrint(String &out, size_t max) : _out(out), _max(max) {}
+  size_t write(uint8_t c) override {
+    return write(&c, 1);
+  }
+  size_t write(const uint8_t *data, size_t len) override {
+    if (len > _max - _out.length()) {
+      len = _max - _out.length();
+    }
+    return len && _out.concat(reinterpret_cast<const char *>(data), len) ? len : 0;
+  }
+
+private:
+  String &_out;
+  size_t _max;
+};
+
+// hash of the URL and the query parameters of a request
+static uint32_t requestHash(AsyncWebServerRequest *request) {
+  HashPrint hash;
+  hash.print(request->url());
+  for (size_t i = 0; i < request->params(); i++) {
+    const AsyncWebParameter *param = request->getParam(i);
+    if (!param->isPost() && !param->isFile()) {
+      hash.write('&');
+      hash.print(param->name());
+      hash.write('=');
+      hash.print(param->value());
+    }
+  }
+  return hash.hash();
+}
+
+// the headers of a response (and its header blocks) rendered as a header block, without the ones added when it is sent
+static String renderHeaders(AsyncWebServerResponse *response) {
+  String headers;
+  if (response->contentType().length()) {
+    headers.concat(asyncsrv::T_Content_Type);
+    headers.concat(": ");
+    headers.concat(response->contentType());
+    headers.concat(asyncsrv::T_rn);
+  }
+  for (const AsyncWebHeader &h : response->getHeaders()) {
+    const String &name = h.name();
+    if (name.equalsIgnoreCase(asyncsrv::T_Content_Length) || name.equalsIgnoreCase(asyncsrv::T_Content_Type) || name.equalsIgnoreCase(asyncsrv::T_Connection)
+        || name.equalsIgnoreCase(asyncsrv::T_Accept_Ranges) || name.equalsIgnoreCase(asyncsrv::T_Transfer_Encoding)) {
+      continue;
+    }
+    headers.concat(name);
+    headers.concat(": ");
+    headers.concat(h.value());
+    headers.concat(asyncsrv::T_rn);
+  }
+  for (const auto &block : response->getHeaderBlocks()) {
+    headers.concat(*block);
+  }
+  return headers;
+}
+
+// copies the content of a response, false if it is not known before being sent
+static bool captureContent(AsyncWebServerResponse *response, String &content) {
+  const size_t length = response->contentLength();
+  if (length && !content.reserve(length)) {
+#ifdef ESP32
+    log_e("Failed to allocate");
+#endif
+    return false;
+  }
+  StringPrint out(content, length);
+  return response->_contentPrint(out) && content.length() == length;
+}
+
+// adds the names of a Vary header value to vary, false if it varies on anything (*)
+static bool varyList(const String &value, std::vector<String> &vary) {
+  if (value.indexOf('*') >= 0) {
+    return false;
+  }
+  for (int start = 0; start < (int)value.length();) {
+    int end = value.indexOf(',', start);
+    if (end < 0) {
+      end = value.length();
+    }
+    String name = value.substring(start, end);
+    name.trim();
+    if (name.length()) {
+      vary.emplace_back(std::move(name));
+    }
+    start = end + 1;
+  }
+  return true;
+}
+
+// request headers listed in the Vary headers of a response (including its header blocks), false if it varies on anything (*)
+// or on a header the server drops (all the requests would then have the same empty value)
+static bool varyHeaders(AsyncWebServerResponse *response, AsyncWebServer *server, std::vector<String> &vary) {
+  const AsyncWebHeader *header = response->getHeader(asyncsrv::T_Vary);
+  if (header && !varyList(header->value(), vary)) {
+    return false;
+  }
+  // the pre-rendered blocks (i.e. the CORS headers) can vary too
+  const size_t nameLength = strlen(asyncsrv::T_Vary);
+  for (const auto &block : response->getHeaderBlocks()) {
+    for (int start = 0; start < (int)block->length();) {
+      int end = block->indexOf(asyncsrv::T_rn, start);
+      if (end < 0) {
+        end = block->length();
+      }
+      if (end - start > (int)nameLength && block->charAt(start + nameLength) == ':'
+          && strncasecmp(block->c_str() + start, asyncsrv::T_Vary, nameLength) == 0
+          && !varyList(block->substring(start + nameLength + 1, end), vary)) {
+        return false;
+      }
+      start = end + 2;
+    }
+  }
+  for (const String &name : vary) {
+    if (!server->_storeHeader(name.c_str(), name.length())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// hash of the values of the request headers a response varies on
+static uint32_t varyHash(AsyncWebServerRequest *request, const std::vector<String> &vary) {
+  HashPrint hash;
+  for (const String &name : vary) {
+    hash.print(request->header(name));
+    hash.write('\n');
+  }
+  return hash.hash();
+}
+
+void AsyncCacheMiddleware::setTTL(const char *prefix, uint32_t seconds) {
+  for (auto &ttl : _ttls) {
+    if (ttl.first == prefix) {
+      ttl.second = seconds * 1000;
+      return;
+    }
+  }
+  _ttls.emplace_back(prefix, seconds * 1000);
+}
+
+uint32_t AsyncCacheMiddleware::_ttlOf(const String &url) const {
+  uint32_t ttl = _ttl;
+  size_t longest = 0;
+  for (const auto &prefix : _ttls) {
+    if (prefix.first.length() >= longest && url.startsWith(prefix.first)) {
+      longest = prefix.first.length();
+      ttl = prefix.second;
+    }
+  }
+  return ttl;
+}
+
+void AsyncCacheMiddleware::_evict(size_t bytes) {
+  while (!_entries.empty() && _bytes + bytes > _maxBytes) {
+    _bytes -= _entries.back().bytes;
+    _entries.pop_back();
+  }
+}
+
+void AsyncCacheMiddleware::_store(AsyncWebServerRequest *request, AsyncWebServerResponse *response, uint32_t hash) {
+  uint32_t ttl = _ttlOf(request->url());
+  const AsyncWebHeader *header = response->getHeader(asyncsrv::T_Cache_Control);
+  if (header) {
+    const String &value = header->value();
+    if (value.indexOf(asyncsrv::T_no_store) >= 0 || value.indexOf(asyncsrv::T_no_cache) >= 0 || value.indexOf(asyncsrv::T_private) >= 0) {
+      return;
+    }
+    int maxAge = value.indexOf(asyncsrv::T_max_age_);
+    if (maxAge >= 0) {
+      ttl = std::min(ttl, (uint32_t)strtoul(value.c_str() + maxAge + strlen(asyncsrv::T_max_age_), nullptr, 10) * 1000);
+    }
+  }
+  if (!ttl) {
+    return;
+  }
+
+  Entry entry = {hash, request->url(), {}, 0, millis(), ttl, 0, nullptr, nullptr};
+  if (!varyHeaders(response, request->_server, entry.vary)) {
+    return;
+  }
+  if (entry.vary.size()) {
+    entry.varyHash = varyHash(request, entry.vary);
+  }
+
+  String headers = renderHeaders(response);
+  const size_t length = response->contentLength();
+  entry.bytes = sizeof(Entry) + entry.url.length() + headers.length() + length;
+  for (const String &name : entry.vary) {
+    entry.bytes += sizeof(String) + name.length();
+  }
+  if (entry.bytes > _maxBytes) {
+    return;
+  }
+
+  String content;
+  if (!captureContent(response, content)) {
+    return;
+  }
+
+  _evict(entry.bytes);
+  entry.headers = std::make_shared<const String>(std::move(headers));
+  entry.content = std::make_shared<const String>(std::move(content));
+  _bytes += entry.bytes;
+  _entries.emplace_front(std::move(entry));
+}
+
+// whether the response to the request may be shared with other clients: it may be built from the credentials or a session
+// cookie of the client, and the cookies are not known at all when the server does not store them (see dropHeader())
+static bool isPublicRequest(AsyncWebServerRequest *request, AsyncWebServer *server) {
+  return !request->hasHeader(asyncsrv::T_AUTH) && !request->hasHeader(asyncsrv::T_Cookie)
+         && server->_storeHeader(asyncsrv::T_Cookie, strlen(asyncsrv::T_Cookie));
+}
+
+void AsyncCacheMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
+  if ((request->method() != HTTP_GET && request->method() != HTTP_HEAD) || !isPublicRequest(request, request->_server)) {
+    next();
+    return;
+  }
+
+  const uint32_t hash = requestHash(request);
+  const uint32_t now = millis();
+  for (auto it = _entries.begin(); it != _entries.end();) {
+    if (it->hash != hash || it->url != request->url()) {
+      ++it;
+    } else if (now - it->stored >= it->ttl) {
+      _bytes -= it->bytes;
+      it = _entries.erase(it);
+    } else if (it->vary.size() && it->varyHash != varyHash(request, it->vary)) {
+      ++it;
+    } else {
+      // hit: the handler is not called
+      _entries.splice(_entries.begin(), _entries, it);
+      AsyncWebServerResponse *response = new AsyncSharedResponse(200, asyncsrv::empty, it->content);
+      response->addHeaderBlock(it->headers);
+      request->send(response);
+      return;
+    }
+  }
+
+  next();
+
+  // no response yet (request paused), or not cacheable
+  AsyncWebServerResponse *response = request->getResponse();
+  if (request->method() == HTTP_GET && response && response->code() == 200 && !response->_started()) {
+    _store(request, response, hash);
+  }
+}
+
+void AsyncCoalesceMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
+  // the conditional and range requests get their own response (304, 206...)
+  if (request->method() != HTTP_GET || request->hasHeader(asyncsrv::T_AUTH) || request->hasHeader(asyncsrv::T_INM)
+      || request->hasHeader(asyncsrv::T_IMS) || request->hasHeader(asyncsrv::T_If_Match) || request->hasHeader(asyncsrv::T_If_Unmodified_Since)
+      || request->hasHeader(asyncsrv::T_If_Range) || request->hasHeader(asyncsrv::T_Range)) {
+    next();
+    return;
+  }
+
+  // the response may be built from a session cookie: only the requests with the same cookies share it,
+  // which cannot be checked if the server drops the Cookie header
+  if (!request->_server->_storeHeader(asyncsrv::T_Cookie, strlen(asyncsrv::T_Cookie))) {
+    next();
+    return;
+  }
+  const String &cookie = request->header(asyncsrv::T_Cookie);
+  const uint32_t hash = HashPrint::hash(reinterpret_cast<const uint8_t *>(cookie.c_str()), cookie.length(), requestHash(request));
+  {
+#ifdef ESP32
+    std::lock_guard<std::mutex> lock(_lock);
+#endif
+    for (Flight &flight : _flights) {
+      if (flight.hash == hash && flight.url == request->url() && flight.cookie == cookie) {
+        // an identical request is being answered: wait for its response
+        flight.followers.push_back({request->pause(), next});
+        return;
+      }
+    }
+  }
+  _lead(request, hash, {});
+  next();
+}
+
+void AsyncCoalesceMiddleware::_lead(AsyncWebServerRequest *request, uint32_t hash, std::vector<Follower> followers) {
+  {
+#ifdef ESP32
+    std::lock_guard<std::mutex> lock(_lock);
+#endif
+    _flights.push_back({request, hash, request->url(), request->header(asyncsrv::T_Cookie), std::move(followers)});
+  }
+  request->_onRespond([this](AsyncWebServerRequest *leader, AsyncWebServerResponse *response) {
+    _land(leader, response);
+  });
+}
+
+void AsyncCoalesceMiddleware::_land(AsyncWebServerRequest *leader, AsyncWebServerResponse *response) {
+  uint32_t hash = 0;
+  std::vector<Follower> followers;
+  {
+#ifdef ESP32
+    std::lock_guard<std::mutex> lock(_lock);
+#endif
+    for (auto it = _flights.begin(); it != _flights.end(); ++it) {
+      if (it->leader == leader) {
+        hash = it->hash;
+        followers = std::move(it->followers);
+        _flights.erase(it);
+        break;
+      }
+    }
+  }
+
+  if (!response) {
+    // no response: the first waiting request still connected takes over
+    for (size_t i = 0; i < followers.size(); i++) {
+      std::shared_ptr<AsyncWebServerRequest> request = followers[i].request.lock();
+      if (request) {
+        ArMiddlewareNext next = followers[i].next;
+        _lead(request.get(), hash, std::vector<Follower>(followers.begin() + i + 1, followers.end()));
+        next();
+        return;
+      }
+    }
+    return;
+  }
+
+  // only a 200 is shared, with the requests having the same values for the headers it varies on
+  std::shared_ptr<const String> headers;
+  std::shared_ptr<const String> content;
+  std::vector<String> vary;
+  uint32_t leaderVary = 0;
+  if (!followers.empty() && response->code() == 200 && varyHeaders(response, leader->_server, vary)) {
+    String bytes;
+    if (captureContent(response, bytes)) {
+      headers = std::make_shared<const String>(renderHeaders(response));
+      content = std::make_shared<const String>(std::move(bytes));
+      leaderVary = varyHash(leader, vary);
+    }
+  }
+  for (Follower &follower : followers) {
+    std::shared_ptr<AsyncWebServerRequest> request = follower.request.lock();
+    if (!request) {
+      continue;
+    }
+    if (content && (vary.empty() || varyHash(request.get(), vary) == leaderVary)) {
+      AsyncWebServerResponse *shared = new AsyncSharedResponse(response->code(), asyncsrv::empty, content);
+      shared->addHeaderBlock(headers);
+      request->send(shared);
+    } else {
+      // the response cannot be shared: the request is handled on its own
+      follower.next();
+    }
   }
 }
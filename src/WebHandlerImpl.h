@@ -17,8 +17,56 @@ class AsyncStaticWebHandler : public AsyncWebHandler {
   using FS = fs::FS;
 
 private:
+  // precompressed variants of a file, by order of preference when equally accepted by the client
+  enum Variant : uint8_t {
+    VARIANT_BROTLI = 0,  // file.br
+    VARIANT_GZIP,        // file.gz
+    VARIANT_IDENTITY,    // file
+    VARIANT_MAX
+  };
+
+  // result of the lookup of an URL, see setCache()
+  struct CacheEntry {
+    String url;
+    String path;       // path of the file (without encoding extension), empty if not found
+    uint8_t variants;  // available variants (bit mask of 1 << Variant)
+    String contentType;
+    // per variant, computed on first response
+    size_t size[VARIANT_MAX];
+    time_t lastWrite[VARIANT_MAX];
+    String etag[VARIANT_MAX];
+    String lastModified[VARIANT_MAX];
+    uint32_t timestamp;
+  };
+
+  // content of a small file kept in memory, see setMemoryCache()
+  struct MemoryCacheEntry {
+    String path;
+    size_t size;
+    time_t lastWrite;
+    std::shared_ptr<uint8_t> data;
+  };
+
+  // file of the index built at startup, see setIndexed()
+  struct IndexEntry {
+    uint32_t name;      // offset in _indexNames of the path relative to the root (without encoding extension)
+    uint8_t variants;   // available variants (bit mask of 1 << Variant)
+    uint32_t size[VARIANT_MAX];
+    uint32_t lastWrite[VARIANT_MAX];
+  };
+
   bool _getFile(AsyncWebServerRequest *request) const;
+  bool _indexGetFile(AsyncWebServerRequest *request) const;
+  const IndexEntry *_indexFind(const char *name) const;
+  bool _indexScan(File dir, uint8_t depth, std::vector<IndexEntry> &entries, std::vector<char> &names);
+  bool _findFile(AsyncWebServerRequest *request) const;
   bool _searchFile(AsyncWebServerRequest *request, const String &path);
+  size_t _acceptedVariants(AsyncWebServerRequest *request, Variant order[VARIANT_MAX]) const;
+  static const char *_variantSuffix(Variant variant);
+  static Variant _variantOf(File &file, const String &path);
+  CacheEntry *_cacheLookup(const String &url);
+  void _cacheStore(const String &url, AsyncWebServerRequest *request, bool found);
+  std::shared_ptr<uint8_t> _memoryCacheGet(File &file, const String &path);
 
 protected:
   FS _fs;
@@ -30,11 +78,28 @@ protected:
   AwsTemplateProcessor _callback;
   bool _isDir;
   bool _tryGzipFirst = true;
+  std::list<CacheEntry> _cache;  // most recently used first
+  size_t _cacheMaxEntries = 0;
+  uint32_t _cacheTTL = 0;
+  std::list<MemoryCacheEntry> _memoryCache;  // most recently used first
+  size_t _memoryCacheBudget = 0;
+  size_t _memoryCacheMaxFileSize = 0;
+  size_t _memoryCacheUsed = 0;
+  size_t _readAheadBlockSize = 0;
+  size_t _readAheadBlocks = 0;
+  bool _indexed = false;
+  size_t _indexMaxBytes = 0;
+  std::vector<IndexEntry> _index;  // sorted by name
+  std::vector<char> _indexNames;   // null-terminated paths
 
 public:
   AsyncStaticWebHandler(const char *uri, FS &fs, const char *path, const char *cache_control);
   bool canHandle(AsyncWebServerRequest *request) const override final;
+  AsyncWebRoute route() const override final {
+    return AsyncWebRoute(ROUTE_PREFIX, _uri.c_str(), _uri.length(), HTTP_GET);
+  }
   void handleRequest(AsyncWebServerRequest *request) override final;
+  // when the client accepts both equally, serve the precompressed variants (.br, .gz) before the plain file (default)
   AsyncStaticWebHandler &setTryGzipFirst(bool value);
   AsyncStaticWebHandler &setIsDir(bool isDir);
   AsyncStaticWebHandler &setDefaultFile(const char *filename);
@@ -53,6 +118,113 @@ public:
   AsyncStaticWebHandler &setLastModified();
 
   AsyncStaticWebHandler &setTemplateProcessor(AwsTemplateProcessor newCallback);
+
+  /**
+   * @brief Cache the result of the file lookups: resolved path, gzip variant, size, ETag, Last-Modified and content type,
+   * as well as the URLs which do not match any file.
+   * A cached file is opened directly, without the exists() calls, and a missing one does not hit the file system at all.
+   * The modification time of the opened file is still read on each request (one stat): the cached ETag and Last-Modified
+   * are only reused while the size and modification time are unchanged, so a rewritten file is never answered with 304.
+   *
+   * @param maxEntries maximum number of cached URLs (the least recently used are evicted), 0 to disable the cache (default)
+   * @param ttl maximum age of an entry in milliseconds, 0 to keep the entries until invalidate() is called
+   * @return AsyncStaticWebHandler&
+   */
+  AsyncStaticWebHandler &setCache(size_t maxEntries, uint32_t ttl = 0);
+  /**
+   * @brief Keep the content of the small files in memory (PSRAM if available) and serve them without reading the file system.
+   * The least recently used files are evicted when the budget is exceeded, and a file is read again when its
+   * modification time or size changes.
+   *
+   * @param budget maximum number of bytes kept in memory, 0 to disable the cache (default)
+   * @param maxFileSize files larger than this size are always read from the file system
+   * @return AsyncStaticWebHandler&
+   */
+  AsyncStaticWebHandler &setMemoryCache(size_t budget, size_t maxFileSize = 16384);
+  /**
+   * @brief Read the files served from the file system in a background task (ESP32 only), see AsyncFileResponse::setReadAhead().
+   * Not used for the files served from the memory cache, nor with a template processor.
+   *
+   * @param blockSize size of the blocks read at once, 0 to read the files from the TCP task (default)
+   * @param blocks number of blocks read ahead per response
+   * @return AsyncStaticWebHandler&
+   */
+  AsyncStaticWebHandler &setReadAhead(size_t blockSize = 4096, size_t blocks = 2);
+  /**
+   * @brief Walk the directory once and keep a sorted index of its files: path, available encodings (.br, .gz), size and
+   * modification time. The lookups are then binary searches without any file system call, the file is only opened
+   * to be served, and its ETag and Last-Modified are derived from the index.
+   * The index is the reference for the files: call rescan() after changing them (a file removed since the index was
+   * built is answered with 404, a file rewritten with the same size keeps its ETag).
+   * The file system must be mounted. If the index does not fit in maxBytes, it is dropped and the files are looked up
+   * on each request as before.
+   *
+   * @param indexed true to build the index, false to drop it
+   * @param maxBytes maximum memory used by the index
+   * @return AsyncStaticWebHandler&
+   */
+  AsyncStaticWebHandler &setIndexed(bool indexed, size_t maxBytes = 16384);
+  // build the index again, to call when the files are changed. Returns false if the index could not be built
+  bool rescan();
+  // number of files in the index
+  size_t indexSize() const {
+    return _index.size();
+  }
+  // memory used by the index, in bytes
+  size_t indexFootprint() const {
+    return _index.capacity() * sizeof(IndexEntry) + _indexNames.capacity();
+  }
+  // forget all the cached lookups and file contents, to call when the files are changed (see also rescan())
+  void invalidate();
+};
+
+// a file embedded in the firmware by tools/webbundle.py
+struct AsyncBundleAsset {
+  const char *path;
+  const uint8_t *data;  // PROGMEM
+  size_t length;
+  const char *etag;
+  const char *contentType;
+  const char *contentEncoding;  // nullptr if not compressed
+  const char *cacheControl;     // nullptr to not send any
+};
+
+// set of files generated by tools/webbundle.py, with a perfect hash table of their paths
+struct AsyncBundle {
+  const AsyncBundleAsset *assets;
+  size_t count;
+  const uint16_t *table;  // asset index + 1 by hash slot, 0 for empty slots
+  size_t tableSize;       // power of 2
+  uint32_t seed;          // initial value of the FNV-1a hash of the paths
+};
+
+class AsyncBundleWebHandler : public AsyncWebHandler {
+private:
+  const AsyncBundle &_bundle;
+  String _uri;
+  String _default_file;
+  String _cache_control;
+
+  const AsyncBundleAsset *_getAsset(AsyncWebServerRequest *request) const;
+
+public:
+  AsyncBundleWebHandler(const char *uri, const AsyncBundle &bundle);
+  bool canHandle(AsyncWebServerRequest *request) const override final;
+  AsyncWebRoute route() const override final {
+    return AsyncWebRoute(ROUTE_SEGMENT, _uri.c_str(), _uri.length(), HTTP_GET);
+  }
+  void handleRequest(AsyncWebServerRequest *request) override final;
+  AsyncBundleWebHandler &setDefaultFile(const char *filename);
+  // overrides the cache policy of the bundle for all its files
+  AsyncBundleWebHandler &setCacheControl(const char *cache_control);
+
+  /**
+   * @brief Look up an embedded file
+   *
+   * @param path path of the file in the bundle (i.e. "/index.html")
+   * @return const AsyncBundleAsset* the file, or nullptr if not in the bundle
+   */
+  const AsyncBundleAsset *find(const char *path) const;
 };
 
 class AsyncCallbackWebHandler : public AsyncWebHandler {
@@ -64,6 +236,10 @@ protected:
   ArUploadHandlerFunction _onUpload;
   ArBodyHandlerFunction _onBody;
   bool _isRegex;
+  AsyncPathPattern _pattern;
+#ifdef ASYNCWEBSERVER_REGEX
+  std::regex _regex;
+#endif
 
 public:
   AsyncCallbackWebHandler() : _uri(), _method(HTTP_ANY), _onRequest(NULL), _onUpload(NULL), _onBody(NULL), _isRegex(false) {}
@@ -82,6 +258,7 @@ public:
   }
 
   bool canHandle(AsyncWebServerRequest *request) const override final;
+  AsyncWebRoute route() const override final;
   void handleRequest(AsyncWebServerRequest *request) override final;
   void handleUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) override final;
   void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override final;
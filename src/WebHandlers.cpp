@@ -98,11 +98,503 @@ AsyncStaticWebHandler &AsyncStaticWebHandler::setLastModified() {
   return setLastModified(last_modified);
 }
 
+AsyncStaticWebHandler &AsyncStaticWebHandler::setCache(size_t maxEntries, uint32_t ttl) {
+  _cacheMaxEntries = maxEntries;
+  _cacheTTL = ttl;
+  while (_cache.size() > _cacheMaxEntries) {
+    _cache.pop_back();
+  }
+  return *this;
+}
+
+AsyncStaticWebHandler &AsyncStaticWebHandler::setMemoryCache(size_t budget, size_t maxFileSize) {
+  _memoryCacheBudget = budget;
+  _memoryCacheMaxFileSize = maxFileSize;
+  while (_memoryCacheUsed > _memoryCacheBudget) {
+    _memoryCacheUsed -= _memoryCache.back().size;
+    _memoryCache.pop_back();
+  }
+  return *this;
+}
+
+AsyncStaticWebHandler &AsyncStaticWebHandler::setReadAhead(size_t blockSize, size_t blocks) {
+  _readAheadBlockSize = blockSize;
+  _readAheadBlocks = blocks;
+  return *this;
+}
+
+AsyncStaticWebHandler &AsyncStaticWebHandler::setIndexed(bool indexed, size_t maxBytes) {
+  _indexMaxBytes = maxBytes;
+  if (indexed) {
+    rescan();
+  } else {
+    _indexed = false;
+    std::vector<IndexEntry>().swap(_index);
+    std::vector<char>().swap(_indexNames);
+  }
+  return *this;
+}
+
+bool AsyncStaticWebHandler::rescan() {
+  // one entry per file during the walk, the variants of a file are merged afterwards
+  std::vector<IndexEntry> entries;
+  std::vector<char> names;
+  File root = _fs.open(_path.length() ? _path : String('/'), fs::FileOpenMode::read);
+  const bool scanned = root && root.isDirectory() && _indexScan(root, 0, entries, names);
+  if (root) {
+    root.close();
+  }
+
+  _indexed = false;
+  std::vector<IndexEntry>().swap(_index);
+  std::vector<char>().swap(_indexNames);
+  if (!scanned) {
+#ifdef ESP32
+    log_w("Unable to index %s within %u bytes", _path.c_str(), _indexMaxBytes);
+#endif
+    return false;
+  }
+
+  std::sort(entries.begin(), entries.end(), [&names](const IndexEntry &a, const IndexEntry &b) {
+    return strcmp(&names[a.name], &names[b.name]) < 0;
+  });
+  _indexNames.reserve(names.size());
+  for (const IndexEntry &entry : entries) {
+    const char *name = &names[entry.name];
+    if (_index.size() && strcmp(&_indexNames[_index.back().name], name) == 0) {
+      IndexEntry &file = _index.back();
+      for (uint8_t v = 0; v < VARIANT_MAX; v++) {
+        if (entry.variants & (1 << v)) {
+          file.size[v] = entry.size[v];
+          file.lastWrite[v] = entry.lastWrite[v];
+        }
+      }
+      file.variants |= entry.variants;
+    } else {
+      _index.push_back(entry);
+      _index.back().name = _indexNames.size();
+      _indexNames.insert(_indexNames.end(), name, name + strlen(name) + 1);
+    }
+  }
+  _index.shrink_to_fit();
+  _indexNames.shrink_to_fit();
+  _indexed = true;
+#ifdef ESP32
+  log_i("Indexed %u files of %s in %u bytes", _index.size(), _path.c_str(), indexFootprint());
+#endif
+  return true;
+}
+
+static size_t growCapacity(size_t capacity, size_t needed) {
+  while (capacity < needed) {
+    capacity = capacity ? capacity * 2 : needed;
+  }
+  return capacity;
+}
+
+bool AsyncStaticWebHandler::_indexScan(File dir, uint8_t depth, std::vector<IndexEntry> &entries, std::vector<char> &names) {
+  File file = dir.openNextFile();
+  while (file) {
+    if (file.isDirectory()) {
+      // bounded recursion, each level keeps a directory open
+      if (depth >= 8 || !_indexScan(file, depth + 1, entries, names)) {
+        file.close();
+        return false;
+      }
+    } else {
+#if defined(ESP32) || defined(LIBRETINY)
+      String name(file.path());
+#else
+      String name(file.fullName());
+#endif
+      name = name.substring(_path.length());
+      Variant variant = VARIANT_IDENTITY;
+      if (name.endsWith(T__br)) {
+        variant = VARIANT_BROTLI;
+      } else if (name.endsWith(T__gz)) {
+        variant = VARIANT_GZIP;
+      }
+      name = name.substring(0, name.length() - strlen(_variantSuffix(variant)));
+
+      // grow the vectors by doubling their capacity, checking the memory they will take before allocating it
+      const size_t entriesCapacity = growCapacity(entries.capacity(), entries.size() + 1);
+      const size_t namesCapacity = growCapacity(names.capacity(), names.size() + name.length() + 1);
+      if (entriesCapacity * sizeof(IndexEntry) + namesCapacity > _indexMaxBytes) {
+        file.close();
+        return false;
+      }
+      entries.reserve(entriesCapacity);
+      names.reserve(namesCapacity);
+
+      IndexEntry entry = {};
+      entry.name = names.size();
+      entry.variants = 1 << variant;
+      entry.size[variant] = file.size();
+      entry.lastWrite[variant] = file.getLastWrite();
+      entries.push_back(entry);
+      names.insert(names.end(), name.c_str(), name.c_str() + name.length() + 1);
+    }
+    file.close();
+    file = dir.openNextFile();
+  }
+  return true;
+}
+
+const AsyncStaticWebHandler::IndexEntry *AsyncStaticWebHandler::_indexFind(const char *name) const {
+  auto it = std::lower_bound(_index.begin(), _index.end(), name, [this](const IndexEntry &entry, const char *name) {
+    return strcmp(&_indexNames[entry.name], name) < 0;
+  });
+  if (it == _index.end() || strcmp(&_indexNames[it->name], name) != 0) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+void AsyncStaticWebHandler::invalidate() {
+  _cache.clear();
+  _memoryCache.clear();
+  _memoryCacheUsed = 0;
+}
+
+std::shared_ptr<uint8_t> AsyncStaticWebHandler::_memoryCacheGet(File &file, const String &path) {
+  const size_t size = file.size();
+  if (!size || size > _memoryCacheMaxFileSize || size > _memoryCacheBudget) {
+    return nullptr;
+  }
+  const time_t lastWrite = file.getLastWrite();
+
+  for (auto it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
+    if (it->path == path) {
+      if (it->size == size && it->lastWrite == lastWrite) {
+        _memoryCache.splice(_memoryCache.begin(), _memoryCache, it);
+        return it->data;
+      }
+      // file changed
+      _memoryCacheUsed -= it->size;
+      _memoryCache.erase(it);
+      break;
+    }
+  }
+
+  uint8_t *buf = nullptr;
+#ifdef ESP32
+  buf = (uint8_t *)ps_malloc(size);
+#endif
+  if (!buf) {
+    buf = (uint8_t *)malloc(size);
+  }
+  if (!buf) {
+#ifdef ESP32
+    log_e("Failed to allocate");
+#endif
+    return nullptr;
+  }
+  std::shared_ptr<uint8_t> data(buf, free);
+  if (file.read(buf, size) != size) {
+    file.seek(0);
+    return nullptr;
+  }
+
+  while (_memoryCacheUsed + size > _memoryCacheBudget) {
+    _memoryCacheUsed -= _memoryCache.back().size;
+    _memoryCache.pop_back();
+  }
+  _memoryCache.push_front({path, size, lastWrite, data});
+  _memoryCacheUsed += size;
+  return data;
+}
+
+AsyncStaticWebHandler::CacheEntry *AsyncStaticWebHandler::_cacheLookup(const String &url) {
+  for (auto it = _cache.begin(); it != _cache.end(); ++it) {
+    if (it->url == url) {
+      if (_cacheTTL && millis() - it->timestamp >= _cacheTTL) {
+        _cache.erase(it);
+        return nullptr;
+      }
+      // move to front (most recently used)
+      _cache.splice(_cache.begin(), _cache, it);
+      return &_cache.front();
+    }
+  }
+  return nullptr;
+}
+
+void AsyncStaticWebHandler::_cacheStore(const String &url, AsyncWebServerRequest *request, bool found) {
+  if (!_cacheMaxEntries) {
+    return;
+  }
+  if (_cache.size() >= _cacheMaxEntries) {
+    _cache.pop_back();
+  }
+  CacheEntry entry;
+  entry.url = url;
+  entry.variants = 0;
+  entry.timestamp = millis();
+  for (size_t i = 0; i < VARIANT_MAX; i++) {
+    entry.size[i] = 0;
+    entry.lastWrite[i] = 0;
+  }
+  if (found) {
+    entry.path = (const char *)request->_tempObject;
+    // record all the available variants once, so that the clients accepting other encodings are served without looking them up
+    Variant served = _variantOf(request->_tempFile, entry.path);
+    entry.variants = 1 << served;
+    for (uint8_t v = 0; v < VARIANT_MAX; v++) {
+      if (v != served && _fs.exists(entry.path + _variantSuffix((Variant)v))) {
+        entry.variants |= 1 << v;
+      }
+    }
+  }
+  _cache.push_front(std::move(entry));
+}
+
+const char *AsyncStaticWebHandler::_variantSuffix(Variant variant) {
+  switch (variant) {
+    case VARIANT_BROTLI: return T__br;
+    case VARIANT_GZIP:   return T__gz;
+    default:             return asyncsrv::empty;
+  }
+}
+
+AsyncStaticWebHandler::Variant AsyncStaticWebHandler::_variantOf(File &file, const String &path) {
+  String name(file.name());
+  if (name.endsWith(T__br) && !path.endsWith(T__br)) {
+    return VARIANT_BROTLI;
+  }
+  if (name.endsWith(T__gz) && !path.endsWith(T__gz)) {
+    return VARIANT_GZIP;
+  }
+  return VARIANT_IDENTITY;
+}
+
+// q-values in thousandths of the encodings listed in an Accept-Encoding header, -1 when not listed
+struct AcceptedEncodings {
+  int br = -1;
+  int gzip = -1;
+  int identity = -1;
+  int any = -1;
+};
+
+// returns false if the request has no Accept-Encoding header
+static bool parseAcceptEncoding(AsyncWebServerRequest *request, AcceptedEncodings &accepted) {
+  const AsyncWebHeader *header = request->getHeader(T_Accept_Encoding);
+  if (!header) {
+    return false;
+  }
+  // Accept-Encoding: br;q=1.0, gzip;q=0.8, *;q=0.1
+  const String &value = header->value();
+  int start = 0;
+  while (start < (int)value.length()) {
+    int end = value.indexOf(',', start);
+    if (end < 0) {
+      end = value.length();
+    }
+    String coding = value.substring(start, end);
+    start = end + 1;
+
+    int weight = 1000;
+    int params = coding.indexOf(';');
+    if (params >= 0) {
+      int qpos = coding.indexOf("q=", params);
+      if (qpos >= 0) {
+        weight = (int)(atof(coding.c_str() + qpos + 2) * 1000);
+      }
+      coding = coding.substring(0, params);
+    }
+    coding.trim();
+
+    if (coding.equalsIgnoreCase(T_br)) {
+      accepted.br = weight;
+    } else if (coding.equalsIgnoreCase(T_gzip) || coding.equalsIgnoreCase(T_x_gzip)) {
+      accepted.gzip = weight;
+    } else if (coding.equalsIgnoreCase(T_identity)) {
+      accepted.identity = weight;
+    } else if (coding == "*") {
+      accepted.any = weight;
+    }
+  }
+  return true;
+}
+
+size_t AsyncStaticWebHandler::_acceptedVariants(AsyncWebServerRequest *request, Variant order[VARIANT_MAX]) const {
+  AcceptedEncodings accepted;
+  parseAcceptEncoding(request, accepted);
+  int q[VARIANT_MAX] = {accepted.br, accepted.gzip, accepted.identity};
+  int qAny = accepted.any;
+
+  // the .gz file was always served when there was no plain file, even to the clients not asking for it:
+  // keep it as a last resort unless explicitly refused
+  const bool gzipFallback = q[VARIANT_GZIP] < 0 && qAny != 0;
+
+  // identity is always acceptable unless refused (RFC 9110): when not listed, it is as good as the best listed encoding,
+  // so that setTryGzipFirst() decides between the plain file and the precompressed ones
+  int best = qAny > 0 ? qAny : 0;
+  for (uint8_t v = 0; v < VARIANT_MAX; v++) {
+    if (q[v] > best) {
+      best = q[v];
+    }
+  }
+  if (q[VARIANT_IDENTITY] < 0) {
+    q[VARIANT_IDENTITY] = qAny == 0 ? 0 : (best ? best : 1000);
+  }
+  // the other encodings not listed take the q-value of *
+  for (uint8_t v = 0; v < VARIANT_MAX; v++) {
+    if (q[v] < 0) {
+      q[v] = qAny > 0 ? qAny : 0;
+    }
+  }
+
+  // by decreasing q-value, ties resolved by preference: br > gzip > identity (identity first if not trying gzip first)
+  const Variant preference[VARIANT_MAX] = {
+    _tryGzipFirst ? VARIANT_BROTLI : VARIANT_IDENTITY,
+    _tryGzipFirst ? VARIANT_GZIP : VARIANT_BROTLI,
+    _tryGzipFirst ? VARIANT_IDENTITY : VARIANT_GZIP,
+  };
+  size_t count = 0;
+  for (Variant v : preference) {
+    if (q[v] > 0) {
+      size_t i = count++;
+      while (i > 0 && q[order[i - 1]] < q[v]) {
+        order[i] = order[i - 1];
+        i--;
+      }
+      order[i] = v;
+    }
+  }
+  if (gzipFallback && q[VARIANT_GZIP] == 0) {
+    order[count++] = VARIANT_GZIP;
+  }
+  return count;
+}
+
 bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request) const {
-  return request->isHTTP() && request->method() == HTTP_GET && request->url().startsWith(_uri) && _getFile(request);
+  return request->isHTTP() && request->methodMatches(HTTP_GET) && request->url().startsWith(_uri) && _getFile(request);
 }
 
+#ifdef ESP32
+#define FILE_IS_REAL(f) (f == true && !f.isDirectory())
+#else
+#define FILE_IS_REAL(f) (f == true)
+#endif
+
 bool AsyncStaticWebHandler::_getFile(AsyncWebServerRequest *request) const {
+  AsyncStaticWebHandler *self = const_cast<AsyncStaticWebHandler *>(this);
+
+  if (_indexed) {
+    return _indexGetFile(request);
+  }
+
+  if (_cacheMaxEntries) {
+    CacheEntry *entry = self->_cacheLookup(request->url());
+    if (entry) {
+      if (entry->path.length() == 0) {
+        // known to be missing
+        return false;
+      }
+      Variant order[VARIANT_MAX];
+      size_t count = _acceptedVariants(request, order);
+      size_t i = 0;
+      while (i < count && !(entry->variants & (1 << order[i]))) {
+        i++;
+      }
+      if (i == count) {
+        // no variant acceptable by this client
+        return false;
+      }
+      request->_tempFile = self->_fs.open(entry->path + _variantSuffix(order[i]), fs::FileOpenMode::read);
+      if (FILE_IS_REAL(request->_tempFile)) {
+        request->_tempObject = strdup(entry->path.c_str());
+        if (request->_tempObject == NULL) {
+#ifdef ESP32
+          log_e("Failed to allocate");
+#endif
+          request->abort();
+          request->_tempFile.close();
+          return false;
+        }
+        return true;
+      }
+      // the file was removed or replaced: look it up again
+      request->_tempFile.close();
+      self->_cache.pop_front();
+    }
+    bool found = _findFile(request);
+    self->_cacheStore(request->url(), request, found);
+    return found;
+  }
+
+  return _findFile(request);
+}
+
+bool AsyncStaticWebHandler::_indexGetFile(AsyncWebServerRequest *request) const {
+  // same resolution as _findFile(), but against the index
+  String path = request->url().substring(_uri.length());
+  bool canSkipFileCheck = (_isDir && path.length() == 0) || (path.length() && path[path.length() - 1] == '/');
+
+  const IndexEntry *entry = nullptr;
+  // the precompressed file requested by its own name (file.gz) is indexed as a variant of the plain file
+  bool asIs = false;
+  if (!canSkipFileCheck) {
+    entry = _indexFind(path.c_str());
+    if (!entry) {
+      for (uint8_t v = VARIANT_BROTLI; v < VARIANT_IDENTITY && !entry; v++) {
+        const char *suffix = _variantSuffix((Variant)v);
+        if (path.endsWith(suffix)) {
+          entry = _indexFind(path.substring(0, path.length() - strlen(suffix)).c_str());
+          asIs = entry && (entry->variants & (1 << v));
+          entry = asIs ? entry : nullptr;
+        }
+      }
+    }
+  }
+
+  if (!entry && _default_file.length()) {
+    if (path.length() == 0 || path[path.length() - 1] != '/') {
+      path += String('/');
+    }
+    path += _default_file;
+    entry = _indexFind(path.c_str());
+  }
+
+  if (!entry) {
+    return false;
+  }
+
+  const char *suffix = asyncsrv::empty;
+  if (!asIs) {
+    Variant order[VARIANT_MAX];
+    size_t count = _acceptedVariants(request, order);
+    size_t i = 0;
+    while (i < count && !(entry->variants & (1 << order[i]))) {
+      i++;
+    }
+    if (i == count) {
+      // no variant acceptable by this client
+      return false;
+    }
+    suffix = _variantSuffix(order[i]);
+  }
+
+  // no file system access here: the file is opened by handleRequest(), which finds the suffix of the variant
+  // after the path in _tempObject ("path\0suffix\0")
+  path = _path + path;
+  const size_t pathLen = path.length();
+  const size_t suffixLen = strlen(suffix);
+  char *tempPath = (char *)malloc(pathLen + 1 + suffixLen + 1);
+  if (tempPath == NULL) {
+#ifdef ESP32
+    log_e("Failed to allocate");
+#endif
+    request->abort();
+    return false;
+  }
+  memcpy(tempPath, path.c_str(), pathLen + 1);
+  memcpy(tempPath + pathLen + 1, suffix, suffixLen + 1);
+  request->_tempObject = (void *)tempPath;
+  return true;
+}
+
+bool AsyncStaticWebHandler::_findFile(AsyncWebServerRequest *request) const {
   // Remove the found uri
   String path = request->url().substring(_uri.length());
 
@@ -130,44 +622,20 @@ bool AsyncStaticWebHandler::_getFile(AsyncWebServerRequest *request) const {
   return const_cast<AsyncStaticWebHandler *>(this)->_searchFile(request, path);
 }
 
-#ifdef ESP32
-#define FILE_IS_REAL(f) (f == true && !f.isDirectory())
-#else
-#define FILE_IS_REAL(f) (f == true)
-#endif
-
 bool AsyncStaticWebHandler::_searchFile(AsyncWebServerRequest *request, const String &path) {
-  bool fileFound = false;
-  bool gzipFound = false;
-
-  String gzip = path + T__gz;
-
-  if (_tryGzipFirst) {
-    if (_fs.exists(gzip)) {
-      request->_tempFile = _fs.open(gzip, fs::FileOpenMode::read);
-      gzipFound = FILE_IS_REAL(request->_tempFile);
-    }
-    if (!gzipFound) {
-      if (_fs.exists(path)) {
-        request->_tempFile = _fs.open(path, fs::FileOpenMode::read);
-        fileFound = FILE_IS_REAL(request->_tempFile);
-      }
-    }
-  } else {
-    if (_fs.exists(path)) {
-      request->_tempFile = _fs.open(path, fs::FileOpenMode::read);
-      fileFound = FILE_IS_REAL(request->_tempFile);
-    }
-    if (!fileFound) {
-      if (_fs.exists(gzip)) {
-        request->_tempFile = _fs.open(gzip, fs::FileOpenMode::read);
-        gzipFound = FILE_IS_REAL(request->_tempFile);
-      }
+  bool found = false;
+
+  // try the variants acceptable by the client, by order of preference
+  Variant order[VARIANT_MAX];
+  size_t count = _acceptedVariants(request, order);
+  for (size_t i = 0; i < count && !found; i++) {
+    String variantPath = path + _variantSuffix(order[i]);
+    if (_fs.exists(variantPath)) {
+      request->_tempFile = _fs.open(variantPath, fs::FileOpenMode::read);
+      found = FILE_IS_REAL(request->_tempFile);
     }
   }
 
-  bool found = fileFound || gzipFound;
-
   if (found) {
     // Extract the file name from the path and keep it in _tempObject
     size_t pathLen = path.length();
@@ -190,6 +658,15 @@ bool AsyncStaticWebHandler::_searchFile(AsyncWebServerRequest *request, const St
 void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request) {
   // Get the filename from request->_tempObject and free it
   String filename((char *)request->_tempObject);
+  if (!request->_tempFile) {
+    // found in the index, not opened yet (see _indexGetFile())
+    const char *suffix = (const char *)request->_tempObject + filename.length() + 1;
+    request->_tempFile = _fs.open(filename + suffix, fs::FileOpenMode::read);
+    if (!FILE_IS_REAL(request->_tempFile)) {
+      // removed since the index was built
+      request->_tempFile.close();
+    }
+  }
   free(request->_tempObject);
   request->_tempObject = NULL;
 
@@ -198,29 +675,65 @@ void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request) {
     return;
   }
 
-  time_t lw = request->_tempFile.getLastWrite();  // get last file mod time (if supported by FS)
-  // set etag to lastmod timestamp if available, otherwise to size
+  const Variant variant = _variantOf(request->_tempFile, filename);
+  const size_t size = request->_tempFile.size();
+  // the modification time is known from the index (call rescan() after changing the files), unless the size changed since
+  // it was built. Otherwise one stat per request, so that the cached ETag of a file rewritten with the same size
+  // is not reused (see setCache())
+  const IndexEntry *indexed = _indexed ? _indexFind(filename.c_str() + _path.length()) : nullptr;
+  time_t lastWrite;
+  if (indexed && (indexed->variants & (1 << variant)) && indexed->size[variant] == size) {
+    lastWrite = indexed->lastWrite[variant];
+  } else {
+    lastWrite = request->_tempFile.getLastWrite();  // 0 if not supported by the FS
+  }
+
+  // reuse the ETag and Last-Modified computed for a previous request if the file did not change
+  CacheEntry *entry = _cacheMaxEntries ? _cacheLookup(request->url()) : nullptr;
+  if (entry && entry->path != filename) {
+    entry = nullptr;
+  }
+  if (entry && (entry->size[variant] != size || entry->lastWrite[variant] != lastWrite)) {
+    // the file was rewritten, possibly with the same size
+    entry->size[variant] = size;
+    entry->lastWrite[variant] = lastWrite;
+    entry->etag[variant] = emptyString;
+  }
+
   String etag;
-  if (lw) {
-    setLastModified(lw);
+  if (entry && entry->etag[variant].length()) {
+    etag = entry->etag[variant];
+    if (entry->lastModified[variant].length()) {
+      _last_modified = entry->lastModified[variant];
+    }
+  } else {
+    time_t lw = lastWrite;  // get last file mod time (if supported by FS)
+    // set etag to lastmod timestamp if available, otherwise to size
+    if (lw) {
+      setLastModified(lw);
 #if defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350)
-    // time_t == long long int
-    constexpr size_t len = 1 + 8 * sizeof(time_t);
-    char buf[len];
-    char *ret = lltoa(lw ^ request->_tempFile.size(), buf, len, 10);
-    etag = ret ? String(ret) : String(request->_tempFile.size());
+      // time_t == long long int
+      constexpr size_t len = 1 + 8 * sizeof(time_t);
+      char buf[len];
+      char *ret = lltoa(lw ^ request->_tempFile.size(), buf, len, 10);
+      etag = ret ? String(ret) : String(request->_tempFile.size());
 #elif defined(LIBRETINY)
-    long val = lw ^ request->_tempFile.size();
-    etag = String(val);
+      long val = lw ^ request->_tempFile.size();
+      etag = String(val);
 #else
-    etag = lw ^ request->_tempFile.size();  // etag combines file size and lastmod timestamp
+      etag = lw ^ request->_tempFile.size();  // etag combines file size and lastmod timestamp
 #endif
-  } else {
+    } else {
 #if defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350) || defined(LIBRETINY)
-    etag = String(request->_tempFile.size());
+      etag = String(request->_tempFile.size());
 #else
-    etag = request->_tempFile.size();
+      etag = request->_tempFile.size();
 #endif
+    }
+    if (entry) {
+      entry->etag[variant] = etag;
+      entry->lastModified[variant] = lw ? _last_modified : emptyString;
+    }
   }
 
   bool not_modified = false;
@@ -238,7 +751,27 @@ void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request) {
     request->_tempFile.close();
     response = new AsyncBasicResponse(304);  // Not modified
   } else {
-    response = new AsyncFileResponse(request->_tempFile, filename, emptyString, false, _callback);
+    AsyncFileResponse *fileResponse = new AsyncFileResponse(request->_tempFile, filename, entry ? entry->contentType : emptyString, false, _callback);
+    if (fileResponse && entry && entry->contentType.length() == 0) {
+      entry->contentType = fileResponse->contentType();
+    }
+    bool inMemory = false;
+    if (fileResponse && _memoryCacheBudget) {
+      std::shared_ptr<uint8_t> image = _memoryCacheGet(request->_tempFile, filename + _variantSuffix(variant));
+      if (image) {
+        fileResponse->setContentImage(image);
+        inMemory = true;
+      }
+    }
+    // no read-ahead for HEAD requests: the content is never sent
+    if (fileResponse && !inMemory && _readAheadBlockSize && request->method() != HTTP_HEAD) {
+      // falls back to reading the file from the TCP task if the blocks cannot be allocated
+      if (fileResponse->setReadAhead(_readAheadBlockSize, _readAheadBlocks)) {
+        // the reader task owns the file and closes it: the request must not close it under a read
+        request->_tempFile = File();
+      }
+    }
+    response = fileResponse;
   }
 
   if (!response) {
@@ -250,6 +783,8 @@ void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request) {
   }
 
   response->addHeader(T_ETag, etag.c_str());
+  // the variant served depends on the Accept-Encoding header of the request
+  response->addHeader(T_Vary, T_Accept_Encoding);
 
   if (_last_modified.length()) {
     response->addHeader(T_Last_Modified, _last_modified.c_str());
@@ -266,47 +801,193 @@ AsyncStaticWebHandler &AsyncStaticWebHandler::setTemplateProcessor(AwsTemplatePr
   return *this;
 }
 
+AsyncBundleWebHandler::AsyncBundleWebHandler(const char *uri, const AsyncBundle &bundle) : _bundle(bundle), _uri(uri), _default_file(F("index.html")) {
+  // Ensure leading '/' and remove the trailing one, like for static files
+  if (_uri.length() == 0 || _uri[0] != '/') {
+    _uri = String('/') + _uri;
+  }
+  if (_uri[_uri.length() - 1] == '/') {
+    _uri = _uri.substring(0, _uri.length() - 1);
+  }
+}
+
+AsyncBundleWebHandler &AsyncBundleWebHandler::setDefaultFile(const char *filename) {
+  _default_file = filename;
+  return *this;
+}
+
+AsyncBundleWebHandler &AsyncBundleWebHandler::setCacheControl(const char *cache_control) {
+  _cache_control = cache_control;
+  return *this;
+}
+
+const AsyncBundleAsset *AsyncBundleWebHandler::find(const char *path) const {
+  if (!_bundle.tableSize) {
+    return nullptr;
+  }
+  // one probe: the hash is perfect for the paths of the bundle, others only need to be rejected
+  const size_t len = strlen(path);
+  const uint32_t hash = HashPrint::hash(reinterpret_cast<const uint8_t *>(path), len, _bundle.seed);
+  const uint16_t index = _bundle.table[hash & (_bundle.tableSize - 1)];
+  if (!index) {
+    return nullptr;
+  }
+  const AsyncBundleAsset *asset = &_bundle.assets[index - 1];
+  return strcmp(asset->path, path) == 0 ? asset : nullptr;
+}
+
+const AsyncBundleAsset *AsyncBundleWebHandler::_getAsset(AsyncWebServerRequest *request) const {
+  const String &url = request->url();
+  if (!url.startsWith(_uri) || (url.length() > _uri.length() && url[_uri.length()] != '/')) {
+    return nullptr;
+  }
+  String path = url.substring(_uri.length());
+  if (path.length() == 0 || path[path.length() - 1] == '/') {
+    if (_default_file.length() == 0) {
+      return nullptr;
+    }
+    if (path.length() == 0) {
+      path = '/';
+    }
+    path += _default_file;
+  }
+  return find(path.c_str());
+}
+
+bool AsyncBundleWebHandler::canHandle(AsyncWebServerRequest *request) const {
+  return request->isHTTP() && request->methodMatches(HTTP_GET) && _getAsset(request);
+}
+
+void AsyncBundleWebHandler::handleRequest(AsyncWebServerRequest *request) {
+  const AsyncBundleAsset *asset = _getAsset(request);
+  if (!asset) {
+    request->send(404);
+    return;
+  }
+
+  if (asset->contentEncoding) {
+    // the bundle only has the compressed bytes: all the content codings are acceptable without Accept-Encoding (RFC 9110)
+    AcceptedEncodings accepted;
+    if (parseAcceptEncoding(request, accepted)) {
+      int q = strcasecmp(asset->contentEncoding, T_br) == 0 ? accepted.br : accepted.gzip;
+      if (q < 0) {
+        q = accepted.any;
+      }
+      if (q <= 0) {
+        request->send(406);
+        return;
+      }
+    }
+  }
+
+  AsyncWebServerResponse *response;
+  if (AsyncETagMiddleware::matches(request, asset->etag)) {
+    response = new AsyncBasicResponse(304);  // Not modified
+  } else {
+    // served from flash without copy
+    response = new AsyncProgmemResponse(200, asset->contentType, asset->data, asset->length);
+  }
+
+  if (!response) {
+#ifdef ESP32
+    log_e("Failed to allocate");
+#endif
+    request->abort();
+    return;
+  }
+
+  response->addHeader(T_ETag, asset->etag);
+  if (asset->contentEncoding) {
+    if (response->code() == 200) {
+      response->addHeader(T_Content_Encoding, asset->contentEncoding);
+    }
+    response->addHeader(T_Vary, T_Accept_Encoding);
+  }
+  if (_cache_control.length()) {
+    response->addHeader(T_Cache_Control, _cache_control.c_str());
+  } else if (asset->cacheControl) {
+    response->addHeader(T_Cache_Control, asset->cacheControl);
+  }
+
+  request->send(response);
+}
+
 void AsyncCallbackWebHandler::setUri(const String &uri) {
   _uri = uri;
   _isRegex = uri.startsWith("^") && uri.endsWith("$");
+#ifdef ASYNCWEBSERVER_REGEX
+  if (_isRegex) {
+    // compiled once, not for each request
+    _regex = std::regex(_uri.c_str());
+    _pattern.compile(emptyString);
+    return;
+  }
+#endif
+  _pattern.compile(_uri);
 }
 
 bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request) const {
-  if (!_onRequest || !request->isHTTP() || !(_method & request->method())) {
+  if (!_onRequest || !request->isHTTP() || !request->methodMatches(_method)) {
     return false;
   }
 
 #ifdef ASYNCWEBSERVER_REGEX
   if (_isRegex) {
-    std::regex pattern(_uri.c_str());
-    std::smatch matches;
-    std::string s(request->url().c_str());
-    if (std::regex_search(s, matches, pattern)) {
-      for (size_t i = 1; i < matches.size(); ++i) {  // start from 1
-        request->_addPathParam(matches[i].str().c_str());
-      }
-    } else {
+    std::cmatch matches;
+    if (!std::regex_search(request->url().c_str(), matches, _regex)) {
       return false;
     }
-  } else
-#endif
-    if (_uri.length() && _uri.startsWith("/*.")) {
-    String uriTemplate = String(_uri);
-    uriTemplate = uriTemplate.substring(uriTemplate.lastIndexOf("."));
-    if (!request->url().endsWith(uriTemplate)) {
-      return false;
+    size_t count = 0;
+    for (size_t i = 1; i < matches.size() && count < ASYNCWEBSERVER_PATH_ARGS_MAX; ++i) {  // start from 1
+      if (matches[i].matched) {
+        request->_pathSpans[count++] = {(uint16_t)matches.position(i), (uint16_t)matches.length(i)};
+      } else {
+        request->_pathSpans[count++] = {0, 0};
+      }
     }
-  } else if (_uri.length() && _uri.endsWith("*")) {
-    String uriTemplate = String(_uri);
-    uriTemplate = uriTemplate.substring(0, uriTemplate.length() - 1);
-    if (!request->url().startsWith(uriTemplate)) {
+    request->_setPathArgs(nullptr, count);
+    return true;
+  }
+#endif
+
+  if (_pattern.valid()) {
+    size_t count;
+    if (!_pattern.match(request->url(), request->_pathSpans, count)) {
       return false;
     }
-  } else if (_uri.length() && (_uri != request->url() && !request->url().startsWith(_uri + "/"))) {
-    return false;
+    request->_setPathArgs(&_pattern, count);
+    return true;
   }
 
-  return true;
+  return route().matches(request->url());
+}
+
+AsyncWebRoute AsyncCallbackWebHandler::route() const {
+  const size_t len = _uri.length();
+#ifdef ASYNCWEBSERVER_REGEX
+  if (_isRegex) {
+    return AsyncWebRoute(ROUTE_ANY, nullptr, 0, _method);
+  }
+#endif
+  if (!len) {
+    return AsyncWebRoute(ROUTE_ANY, nullptr, 0, _method);
+  }
+  const char *uri = _uri.c_str();
+  if (_pattern.valid()) {
+    // "/devices/{id}": the URLs starting with the literal part of the pattern
+    return AsyncWebRoute(ROUTE_PREFIX, uri, _pattern.prefixLength(), _method);
+  }
+  if (strncmp(uri, "/*.", 3) == 0) {
+    // "/*.ext": any URL ending with ".ext"
+    const int ext = _uri.lastIndexOf('.');
+    return AsyncWebRoute(ROUTE_EXTENSION, uri + ext, len - ext, _method);
+  }
+  if (uri[len - 1] == '*') {
+    // "/path*": any URL starting with "/path"
+    return AsyncWebRoute(ROUTE_PREFIX, uri, len - 1, _method);
+  }
+  // "/path": the URL "/path" and the ones below "/path/"
+  return AsyncWebRoute(ROUTE_SEGMENT, uri, len, _method);
 }
 
 void AsyncCallbackWebHandler::handleRequest(AsyncWebServerRequest *request) {
@@ -4,6 +4,7 @@
 #include "ESPAsyncWebServer.h"
 #include "WebAuthentication.h"
 #include "WebResponseImpl.h"
+#include "WebRouter.h"
 #include "literals.h"
 #include <cstring>
 
@@ -86,8 +87,21 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer *s, AsyncClient *c)
 AsyncWebServerRequest::~AsyncWebServerRequest() {
   // log_e("AsyncWebServerRequest::~AsyncWebServerRequest");
 
+  if (_onRespondfn) {
+    ArRespondHandler fn = std::move(_onRespondfn);
+    _onRespondfn = nullptr;
+    fn(this, nullptr);
+  }
+  if (_onFinishfn) {
+    ArRespondHandler fn = std::move(_onFinishfn);
+    _onFinishfn = nullptr;
+    fn(this, _response);
+  }
+
   _this.reset();
 
+  _server->_sendDetach(this);
+
   _headers.clear();
 
   _pathParams.clear();
@@ -107,6 +121,11 @@ AsyncWebServerRequest::~AsyncWebServerRequest() {
   if (_itemBuffer) {
     free(_itemBuffer);
   }
+
+  // the handler of the request may have been removed meanwhile: it is deleted with the last request using it
+  if (_routes) {
+    _routes->release();
+  }
 }
 
 void AsyncWebServerRequest::_onData(void *buf, size_t len) {
@@ -224,6 +243,7 @@ void AsyncWebServerRequest::_onPoll() {
     if (!_response->_finished()) {
       _response->_ack(this, 0, 0);
     } else {
+      _server->_sendDetach(this);
       AsyncWebServerResponse *r = _response;
       _response = NULL;
       delete r;
@@ -239,6 +259,7 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time) {
     if (!_response->_finished()) {
       _response->_ack(this, len, time);
     } else if (_response->_finished()) {
+      _server->_sendDetach(this);
       AsyncWebServerResponse *r = _response;
       _response = NULL;
       delete r;
@@ -262,6 +283,18 @@ void AsyncWebServerRequest::onDisconnect(ArDisconnectHandler fn) {
   _onDisconnectfn = fn;
 }
 
+void AsyncWebServerRequest::_addRespondHandler(ArRespondHandler &handlers, ArRespondHandler fn) {
+  if (!handlers) {
+    handlers = fn;
+    return;
+  }
+  ArRespondHandler first = std::move(handlers);
+  handlers = [first, fn](AsyncWebServerRequest *request, AsyncWebServerResponse *response) {
+    first(request, response);
+    fn(request, response);
+  };
+}
+
 void AsyncWebServerRequest::_onDisconnect() {
   // os_printf("d\n");
   if (_onDisconnectfn) {
@@ -270,8 +303,10 @@ void AsyncWebServerRequest::_onDisconnect() {
   _server->_handleDisconnect(this);
 }
 
-void AsyncWebServerRequest::_addPathParam(const char *p) {
-  _pathParams.emplace_back(p);
+void AsyncWebServerRequest::_setPathArgs(const AsyncPathPattern *pattern, size_t count) {
+  _pathPattern = pattern;
+  _pathSpanCount = count;
+  _pathParams.clear();
 }
 
 void AsyncWebServerRequest::_addGetParams(const String &params) {
@@ -342,7 +377,9 @@ bool AsyncWebServerRequest::_parseReqHead() {
 }
 
 bool AsyncWebServerRequest::_parseReqHeader() {
-  AsyncWebHeader header = AsyncWebHeader::parse(_temp);
+  // the headers the server does not store are skipped before being copied
+  const int colon = _temp.indexOf(':');
+  AsyncWebHeader header = colon <= 0 || _server->_storeHeader(_temp.c_str(), colon) ? AsyncWebHeader::parse(_temp) : AsyncWebHeader();
   if (header) {
     const String &name = header.name();
     const String &value = header.value();
@@ -691,18 +728,38 @@ void AsyncWebServerRequest::_parseLine() {
 }
 
 void AsyncWebServerRequest::_runMiddlewareChain() {
-  if (_handler && _handler->mustSkipServerMiddlewares()) {
-    _handler->_runChain(this, [this]() {
-      _handler->handleRequest(this);
-    });
+  // the middlewares of the server then the ones of the handler, in one array walked by _nextMiddleware()
+  // and kept by the request until the chain completes, even if the middlewares change meanwhile
+  if (_handler) {
+    _chain = _handler->_compileChain(_handler->mustSkipServerMiddlewares() ? nullptr : _server);
   } else {
-    _server->_runChain(this, [this]() {
-      if (_handler) {
-        _handler->_runChain(this, [this]() {
-          _handler->handleRequest(this);
-        });
-      }
-    });
+    _chain = _server->_compileChain(nullptr);
+  }
+  _chainIndex = 0;
+  _nextMiddleware();
+}
+
+void AsyncWebServerRequest::_nextMiddleware() {
+  if (!_chain) {
+    return;
+  }
+  // called later by a middleware which paused the request: the response is sent once the chain completes
+  const bool resumed = _paused;
+  if (resumed) {
+    _paused = false;
+    _client->setRxTimeout(_rx_timeout);
+  }
+  if (_chainIndex < _chain->size()) {
+    AsyncMiddleware *m = (*_chain)[_chainIndex++].get();
+    m->run(this, _chainNext);
+  } else {
+    _chain = nullptr;
+    if (_handler) {
+      _handler->handleRequest(this);
+    }
+  }
+  if (resumed) {
+    _send();
   }
 }
 
@@ -720,6 +777,12 @@ void AsyncWebServerRequest::_send() {
       send(500, T_text_plain, "Invalid data in handler");
     }
 
+    if (_onRespondfn) {
+      ArRespondHandler fn = std::move(_onRespondfn);
+      _onRespondfn = nullptr;
+      fn(this, _response);
+    }
+
     // here, we either have a response give nfrom user or one of the two above
     _response->_respond(this);
     _sent = true;
@@ -884,6 +947,10 @@ AsyncWebServerResponse *
 
 AsyncWebServerResponse *
   AsyncWebServerRequest::beginResponse(FS &fs, const String &path, const char *contentType, bool download, AwsTemplateProcessor callback) {
+  AsyncMappedRegion region;
+  if (_server->_mapFile(fs, path, region)) {
+    return new AsyncMappedResponse(region, path, contentType, download, callback);
+  }
   if (fs.exists(path) || (!download && fs.exists(path + T__gz))) {
     return new AsyncFileResponse(fs, path, contentType, download, callback);
   }
@@ -902,6 +969,11 @@ AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(Stream &stream, con
   return new AsyncStreamResponse(stream, contentType, len, callback);
 }
 
+AsyncWebServerResponse *
+  AsyncWebServerRequest::beginResponse(Stream &stream, const char *contentType, AwsStreamCompletion completion, AwsTemplateProcessor callback) {
+  return new AsyncStreamResponse(stream, contentType, completion, callback);
+}
+
 AsyncWebServerResponse *
   AsyncWebServerRequest::beginResponse(const char *contentType, size_t len, AwsResponseFiller callback, AwsTemplateProcessor templateCallback) {
   return new AsyncCallbackResponse(contentType, len, callback, templateCallback);
@@ -1084,12 +1156,21 @@ const String &AsyncWebServerRequest::argName(size_t i) const {
 }
 
 const String &AsyncWebServerRequest::pathArg(size_t i) const {
-  if (i >= _pathParams.size()) {
+  if (i >= _pathSpanCount) {
     return emptyString;
   }
-  auto it = _pathParams.begin();
-  std::advance(it, i);
-  return *it;
+  if (_pathParams.empty()) {
+    _pathParams.reserve(_pathSpanCount);
+    for (size_t n = 0; n < _pathSpanCount; n++) {
+      _pathParams.emplace_back(_url.c_str() + _pathSpans[n].start, _pathSpans[n].length);
+    }
+  }
+  return _pathParams[i];
+}
+
+const String &AsyncWebServerRequest::pathArg(const char *name) const {
+  const int i = _pathPattern ? _pathPattern->indexOf(name) : -1;
+  return i < 0 ? emptyString : pathArg((size_t)i);
 }
 
 const String &AsyncWebServerRequest::header(const char *name) const {
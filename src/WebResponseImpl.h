@@ -9,10 +9,14 @@
 #undef min
 #undef max
 #endif
+#include "HashPrint.h"
 #include "literals.h"
 #include <cbuf.h>
 #include <memory>
 #include <vector>
+#ifdef ESP32
+#include <esp_partition.h>
+#endif
 
 // It is possible to restore these defines, but one can use _min and _max instead. Or std::min, std::max.
 
@@ -29,6 +33,31 @@ public:
   bool _sourceValid() const override final {
     return true;
   }
+  bool _contentHash(uint32_t &hash) override final;
+  bool _contentPrint(Print &out) override final;
+};
+
+/**
+ * @brief Response sent from bytes rendered beforehand (status line, headers and content), shared by all the responses
+ * sending them: i.e. the preflight responses of AsyncCorsMiddleware.
+ */
+class AsyncPrerenderedResponse : public AsyncWebServerResponse {
+private:
+  std::shared_ptr<const String> _bytes;
+  size_t _write(AsyncWebServerRequest *request);
+
+public:
+  // response to render: a head without content (and without content-length)
+  explicit AsyncPrerenderedResponse(int code);
+  // response sending the bytes, code being the one rendered in them
+  AsyncPrerenderedResponse(int code, std::shared_ptr<const String> bytes);
+  // renders the head of the response as HTTP/1.1, with its headers and header block
+  std::shared_ptr<const String> render();
+  void _respond(AsyncWebServerRequest *request) override final;
+  size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time) override final;
+  bool _sourceValid() const override final {
+    return _bytes != nullptr;
+  }
 };
 
 class AsyncAbstractResponse : public AsyncWebServerResponse {
@@ -47,6 +76,8 @@ private:
   std::vector<uint8_t> _cache;
   size_t _readDataFromCacheOrContent(uint8_t *data, const size_t len);
   size_t _fillBufferAndProcessTemplates(uint8_t *buf, size_t maxLen);
+  size_t _writeContentSpan(AsyncWebServerRequest *request, const uint8_t *data, size_t len);
+  size_t _writeHead(AsyncWebServerRequest *request);
 
 protected:
   AwsTemplateProcessor _callback;
@@ -54,7 +85,7 @@ protected:
 public:
   AsyncAbstractResponse(AwsTemplateProcessor callback = nullptr);
   virtual ~AsyncAbstractResponse() {}
-  void _respond(AsyncWebServerRequest *request) override final;
+  void _respond(AsyncWebServerRequest *request) override;
   size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time) override final;
   virtual bool _sourceValid() const {
     return false;
@@ -62,6 +93,21 @@ public:
   virtual size_t _fillBuffer(uint8_t *buf __attribute__((unused)), size_t maxLen __attribute__((unused))) {
     return 0;
   }
+  /**
+   * @brief Zero-copy content source.
+   * Sources which already hold their content in addressable memory (RAM, memory-mapped flash, etc) can override this method
+   * to expose it directly instead of copying it through _fillBuffer(): the data is then handed as is to the TCP stack.
+   * Only used for responses with a known content length and without template processing.
+   *
+   * @param index offset of the requested data from the beginning of the content
+   * @param len set to the number of contiguous bytes available from index
+   * @return const uint8_t* pointer to the content at index, or nullptr if the source does not support it (default)
+   */
+  virtual const uint8_t *_contentSpan(size_t index __attribute__((unused)), size_t &len __attribute__((unused))) const {
+    return nullptr;
+  }
+  bool _contentHash(uint32_t &hash) override;
+  bool _contentPrint(Print &out) override;
 };
 
 #ifndef TEMPLATE_PLACEHOLDER
@@ -69,6 +115,20 @@ public:
 #endif
 
 #define TEMPLATE_PARAM_NAME_LENGTH 32
+
+// Background read-ahead of the file responses (ESP32 only), see AsyncFileResponse::setReadAhead()
+#ifndef ASYNCWEBSERVER_READ_AHEAD_TASK_PRIORITY
+#define ASYNCWEBSERVER_READ_AHEAD_TASK_PRIORITY 5
+#endif
+#ifndef ASYNCWEBSERVER_READ_AHEAD_TASK_STACK
+#define ASYNCWEBSERVER_READ_AHEAD_TASK_STACK 4096
+#endif
+#ifndef ASYNCWEBSERVER_READ_AHEAD_QUEUE_LENGTH
+#define ASYNCWEBSERVER_READ_AHEAD_QUEUE_LENGTH 16
+#endif
+
+class AsyncFileReadAhead;
+
 class AsyncFileResponse : public AsyncAbstractResponse {
   using File = fs::File;
   using FS = fs::FS;
@@ -76,6 +136,11 @@ class AsyncFileResponse : public AsyncAbstractResponse {
 private:
   File _content;
   String _path;
+  // optional memory image of the file content (see AsyncStaticWebHandler::setMemoryCache)
+  std::shared_ptr<uint8_t> _image;
+  size_t _readLength{0};
+  // optional background reader, shared with the storage task
+  std::shared_ptr<AsyncFileReadAhead> _readAhead;
   void _setContentTypeFromPath(const String &path);
 
 public:
@@ -87,23 +152,108 @@ public:
   );
   AsyncFileResponse(File content, const String &path, const String &contentType, bool download = false, AwsTemplateProcessor callback = nullptr)
     : AsyncFileResponse(content, path, contentType.c_str(), download, callback) {}
-  ~AsyncFileResponse() {
-    _content.close();
+  ~AsyncFileResponse();
+
+  /**
+   * @brief Serve the content from a memory image of the whole file instead of reading the file, which is closed.
+   * The image is shared, it can be dropped from a cache while the response is sent.
+   *
+   * @param image content of the file, of the size of the file
+   */
+  void setContentImage(std::shared_ptr<uint8_t> image);
+
+  /**
+   * @brief Read the file in a background storage task instead of the TCP task (ESP32 only).
+   * The next blocks are read while the current one is being sent, so slow storage (SD cards...) never blocks
+   * the other connections. When no block is ready yet, the response waits for the next ack or poll.
+   * Must be called before the response is sent. The file is then closed by the background task: the other handles
+   * sharing it (i.e. request->_tempFile) must be released, not closed.
+   *
+   * @param blockSize size of the blocks read at once, a multiple of the file system block size
+   * @param blocks number of blocks (2 for double buffering, 3 for triple buffering...)
+   * @return true if the read-ahead is enabled
+   */
+  bool setReadAhead(size_t blockSize = 4096, size_t blocks = 2);
+
+  bool _sourceValid() const override final {
+    return _image || _readAhead || !!(_content);
   }
+  size_t _fillBuffer(uint8_t *buf, size_t maxLen) override final;
+  const uint8_t *_contentSpan(size_t index, size_t &len) const override final;
+};
+
+class AsyncMappedResponse : public AsyncAbstractResponse {
+private:
+  AsyncMappedRegion _region;
+  // start of the content sent in the region (range requests)
+  size_t _offset{0};
+  size_t _readLength{0};
+  void _applyRange(const String &range);
+
+public:
+  AsyncMappedResponse(
+    const AsyncMappedRegion &region, const String &path, const char *contentType = asyncsrv::empty, bool download = false,
+    AwsTemplateProcessor callback = nullptr
+  );
+  AsyncMappedResponse(
+    const AsyncMappedRegion &region, const String &path, const String &contentType, bool download = false, AwsTemplateProcessor callback = nullptr
+  )
+    : AsyncMappedResponse(region, path, contentType.c_str(), download, callback) {}
+  ~AsyncMappedResponse();
+
+#ifdef ESP32
+  /**
+   * @brief Map a whole flash partition in the data address space, to serve it with an AsyncMappedResponse.
+   * The content is read through the flash cache, so it is decrypted for an encrypted partition.
+   * Fails if the partition does not fit in the free MMU pages.
+   *
+   * @param partition partition to map
+   * @param region set to the mapped content, unmapped when the response is destroyed
+   * @return true if the partition is mapped
+   */
+  static bool mapPartition(const esp_partition_t *partition, AsyncMappedRegion &region);
+#endif
+
+  void _respond(AsyncWebServerRequest *request) override final;
   bool _sourceValid() const override final {
-    return !!(_content);
+    return _region.data || !_region.length;
   }
   size_t _fillBuffer(uint8_t *buf, size_t maxLen) override final;
+  const uint8_t *_contentSpan(size_t index, size_t &len) const override final;
 };
 
 class AsyncStreamResponse : public AsyncAbstractResponse {
 private:
   Stream *_content;
+  AwsStreamCompletion _completion;
+  size_t _readLength{0};
+  // optional read-ahead ring buffer
+  std::unique_ptr<uint8_t[]> _readAhead;
+  size_t _readAheadSize{0};
+  size_t _readAheadStart{0};
+  size_t _readAheadLength{0};
+  size_t _readStream(uint8_t *data, size_t len);
+  void _fillReadAhead();
 
 public:
   AsyncStreamResponse(Stream &stream, const char *contentType, size_t len, AwsTemplateProcessor callback = nullptr);
   AsyncStreamResponse(Stream &stream, const String &contentType, size_t len, AwsTemplateProcessor callback = nullptr)
     : AsyncStreamResponse(stream, contentType.c_str(), len, callback) {}
+  // stream of unknown length: content is sent chunked until the completion predicate returns true
+  AsyncStreamResponse(Stream &stream, const char *contentType, AwsStreamCompletion completion, AwsTemplateProcessor callback = nullptr);
+  AsyncStreamResponse(Stream &stream, const String &contentType, AwsStreamCompletion completion, AwsTemplateProcessor callback = nullptr)
+    : AsyncStreamResponse(stream, contentType.c_str(), completion, callback) {}
+
+  /**
+   * @brief Drain the stream into a read-ahead buffer of the given size each time data is requested,
+   * so that slow or byte-oriented streams (UART...) are read in bulk and not lost between two sends.
+   * Must be called before the response is sent.
+   *
+   * @param bufferSize size of the buffer (0 to disable)
+   * @return true if the buffer was allocated
+   */
+  bool setReadAhead(size_t bufferSize);
+
   bool _sourceValid() const override final {
     return !!(_content);
   }
@@ -153,11 +303,33 @@ public:
     return true;
   }
   size_t _fillBuffer(uint8_t *buf, size_t maxLen) override final;
+  const uint8_t *_contentSpan(size_t index, size_t &len) const override final;
+  bool _contentHash(uint32_t &hash) override final;
+  bool _contentPrint(Print &out) override final;
+};
+
+/**
+ * @brief Response whose content is shared with other responses, i.e. the responses sent by AsyncCacheMiddleware.
+ */
+class AsyncSharedResponse : public AsyncAbstractResponse {
+private:
+  std::shared_ptr<const String> _content;
+  size_t _readLength;
+
+public:
+  AsyncSharedResponse(int code, const char *contentType, std::shared_ptr<const String> content);
+  bool _sourceValid() const override final {
+    return _content != nullptr;
+  }
+  size_t _fillBuffer(uint8_t *buf, size_t maxLen) override final;
+  const uint8_t *_contentSpan(size_t index, size_t &len) const override final;
 };
 
 class AsyncResponseStream : public AsyncAbstractResponse, public Print {
 private:
   std::unique_ptr<cbuf> _content;
+  // hash of the content, updated while written, since the buffer cannot be read without being consumed
+  HashPrint _hash;
 
 public:
   AsyncResponseStream(const char *contentType, size_t bufferSize);
@@ -166,6 +338,11 @@ public:
     return (_state < RESPONSE_END);
   }
   size_t _fillBuffer(uint8_t *buf, size_t maxLen) override final;
+  bool _contentHash(uint32_t &hash) override final {
+    hash = _hash.hash();
+    return true;
+  }
+  bool _contentPrint(Print &out) override final;
   size_t write(const uint8_t *data, size_t len);
   size_t write(uint8_t data);
   /**
@@ -4,6 +4,13 @@
 #include "ESPAsyncWebServer.h"
 #include "WebResponseImpl.h"
 
+#ifdef ESP32
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#endif
+
 using namespace asyncsrv;
 
 // Since ESP8266 does not link memchr by default, here's its implementation.
@@ -201,6 +208,9 @@ void AsyncWebServerResponse::_assembleHead(String &buffer, uint8_t version) {
   for (const auto &header : _headers) {
     len += header.name().length() + header.value().length() + 4;
   }
+  for (const auto &block : _headerBlocks) {
+    len += block->length();
+  }
 
   // prepare buffer
   buffer.reserve(len);
@@ -229,6 +239,9 @@ void AsyncWebServerResponse::_assembleHead(String &buffer, uint8_t version) {
     buffer.concat(header.value());
     buffer.concat(T_rn);
   }
+  for (const auto &block : _headerBlocks) {
+    buffer.concat(*block);
+  }
 
   buffer.concat(T_rn);
   _headLength = buffer.length();
@@ -277,6 +290,11 @@ void AsyncBasicResponse::_respond(AsyncWebServerRequest *request) {
   _state = RESPONSE_HEADERS;
   String out;
   _assembleHead(out, request->version());
+  if (request->method() == HTTP_HEAD) {
+    // same headers as for a GET request, but no content
+    _content = emptyString;
+    _contentLength = 0;
+  }
   size_t outLen = out.length();
   size_t space = request->client()->space();
   if (!_contentLength && space >= outLen) {
@@ -308,6 +326,22 @@ void AsyncBasicResponse::_respond(AsyncWebServerRequest *request) {
   }
 }
 
+bool AsyncBasicResponse::_contentHash(uint32_t &hash) {
+  if (_started()) {
+    return false;
+  }
+  hash = HashPrint::hash(reinterpret_cast<const uint8_t *>(_content.c_str()), _content.length());
+  return true;
+}
+
+bool AsyncBasicResponse::_contentPrint(Print &out) {
+  if (_started()) {
+    return false;
+  }
+  out.print(_content);
+  return true;
+}
+
 size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time) {
   (void)time;
   _ackedLength += len;
@@ -335,6 +369,58 @@ size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint
   return 0;
 }
 
+/*
+ * Prerendered Response
+ * */
+
+AsyncPrerenderedResponse::AsyncPrerenderedResponse(int code) {
+  _code = code;
+  _sendContentLength = false;
+}
+
+AsyncPrerenderedResponse::AsyncPrerenderedResponse(int code, std::shared_ptr<const String> bytes) : _bytes(std::move(bytes)) {
+  _code = code;
+  // the headers are in the bytes
+  _headers.clear();
+}
+
+std::shared_ptr<const String> AsyncPrerenderedResponse::render() {
+  String head;
+  _assembleHead(head, 1);
+  _bytes = std::make_shared<const String>(std::move(head));
+  return _bytes;
+}
+
+void AsyncPrerenderedResponse::_respond(AsyncWebServerRequest *request) {
+  _headLength = _bytes->length();
+  _state = RESPONSE_CONTENT;
+  _write(request);
+}
+
+size_t AsyncPrerenderedResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time) {
+  (void)time;
+  _ackedLength += len;
+  if (_state == RESPONSE_CONTENT) {
+    return _write(request);
+  }
+  if (_state == RESPONSE_WAIT_ACK && _ackedLength >= _writtenLength) {
+    _state = RESPONSE_END;
+  }
+  return 0;
+}
+
+size_t AsyncPrerenderedResponse::_write(AsyncWebServerRequest *request) {
+  size_t len = std::min(_bytes->length() - _writtenLength, request->client()->space());
+  if (len) {
+    len = request->client()->write(_bytes->c_str() + _writtenLength, len);
+    _writtenLength += len;
+  }
+  if (_writtenLength == _bytes->length()) {
+    _state = RESPONSE_WAIT_ACK;
+  }
+  return len;
+}
+
 /*
  * Abstract Response
  * */
@@ -349,8 +435,21 @@ AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback) : _c
 }
 
 void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request) {
+  if (_chunked && !request->version()) {
+    // HTTP/1.0 does not support chunked transfer encoding: the end of the content will be signaled by closing the connection
+    _chunked = false;
+  }
   addHeader(T_Connection, T_close, false);
   _assembleHead(_head, request->version());
+  request->_server->_sendAttach(request, request->_handler ? request->_handler->sendPriority() : SEND_PRIORITY_NORMAL);
+  if (request->method() == HTTP_HEAD) {
+    // same headers as for a GET request (including the content length, if known), but the content is never read:
+    // the response ends after the head
+    _chunked = false;
+    _sendContentLength = true;
+    _contentLength = 0;
+    _callback = nullptr;
+  }
   _state = RESPONSE_HEADERS;
   _ack(request, 0, 0);
 }
@@ -383,6 +482,10 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
 
   _ackedLength += len;
   size_t space = request->client()->space();
+  if (_state == RESPONSE_HEADERS || _state == RESPONSE_CONTENT) {
+    // share of the server send scheduler (whole space if disabled)
+    space = request->_server->_sendGrant(request, space, _ackedLength >= _writtenLength);
+  }
 
   size_t headLen = _head.length();
   if (_state == RESPONSE_HEADERS) {
@@ -393,6 +496,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
       String out = _head.substring(0, space);
       _head = _head.substring(space);
       _writtenLength += request->client()->write(out.c_str(), out.length());
+      request->_server->_sendConsume(request, out.length());
 #if ASYNCWEBSERVER_USE_CHUNK_INFLIGHT
       _in_flight += out.length();
       --_in_flight_credit;  // take a credit
@@ -417,6 +521,11 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     }
 #endif
 
+    if (!space && !headLen) {
+      // no share left in this round: reading 0 bytes would end a response of unknown length
+      return 0;
+    }
+
     size_t outLen;
     if (_chunked) {
       if (space <= 8) {
@@ -430,6 +539,20 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
       outLen = ((_contentLength - _sentLength) > space) ? space : (_contentLength - _sentLength);
     }
 
+    if (!_chunked && _sendContentLength && _sentLength == _contentLength) {
+      // nothing to read from the source (empty content or HEAD request): only the head is left to send
+      return _writeContentSpan(request, nullptr, 0);
+    }
+
+    // zero-copy path: the source exposes its content, no need to fill an intermediate buffer
+    if (!_chunked && _sendContentLength && !_callback) {
+      size_t spanLen = 0;
+      const uint8_t *span = _contentSpan(_sentLength, spanLen);
+      if (span) {
+        return _writeContentSpan(request, span, std::min(outLen, spanLen));
+      }
+    }
+
     uint8_t *buf = (uint8_t *)malloc(outLen + headLen);
     if (!buf) {
 #ifdef ESP32
@@ -451,7 +574,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
       readLen = _fillBufferAndProcessTemplates(buf + headLen + 6, outLen - 8);
       if (readLen == RESPONSE_TRY_AGAIN) {
         free(buf);
-        return 0;
+        return _writeHead(request);
       }
       outLen = sprintf((char *)buf + headLen, "%04x", readLen) + headLen;
       buf[outLen++] = '\r';
@@ -463,7 +586,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
       readLen = _fillBufferAndProcessTemplates(buf + headLen, outLen);
       if (readLen == RESPONSE_TRY_AGAIN) {
         free(buf);
-        return 0;
+        return _writeHead(request);
       }
       outLen = readLen + headLen;
     }
@@ -474,6 +597,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
 
     if (outLen) {
       _writtenLength += request->client()->write((const char *)buf, outLen);
+      request->_server->_sendConsume(request, outLen);
 #if ASYNCWEBSERVER_USE_CHUNK_INFLIGHT
       _in_flight += outLen;
       --_in_flight_credit;  // take a credit
@@ -504,6 +628,78 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
   return 0;
 }
 
+bool AsyncAbstractResponse::_contentHash(uint32_t &hash) {
+  // only possible if the content can be read without being consumed
+  if (_callback || !_sendContentLength) {
+    return false;
+  }
+  size_t len = 0;
+  const uint8_t *data = _contentSpan(0, len);
+  if (!data || len != _contentLength) {
+    return false;
+  }
+  hash = HashPrint::hash(data, len);
+  return true;
+}
+
+bool AsyncAbstractResponse::_contentPrint(Print &out) {
+  if (_callback || !_sendContentLength) {
+    return false;
+  }
+  size_t len = 0;
+  const uint8_t *data = _contentSpan(0, len);
+  if (!data || len != _contentLength) {
+    return false;
+  }
+  out.write(data, len);
+  return true;
+}
+
+size_t AsyncAbstractResponse::_writeHead(AsyncWebServerRequest *request) {
+  // the content is not ready yet, but the head can already be sent
+  if (!_head.length()) {
+    return 0;
+  }
+  const size_t written = request->client()->write(_head.c_str(), _head.length());
+  _head = emptyString;
+  _writtenLength += written;
+  request->_server->_sendConsume(request, written);
+#if ASYNCWEBSERVER_USE_CHUNK_INFLIGHT
+  _in_flight += written;
+  --_in_flight_credit;  // take a credit
+#endif
+  return written;
+}
+
+size_t AsyncAbstractResponse::_writeContentSpan(AsyncWebServerRequest *request, const uint8_t *data, size_t len) {
+  // lwIP copies the data in its own buffers anyway (see AsyncEventSourceMessage::write),
+  // so queue the headers and the content separately and push them in one go.
+  AsyncClient *client = request->client();
+  size_t written = 0;
+  if (_head.length()) {
+    written += client->add(_head.c_str(), _head.length(), ASYNC_WRITE_FLAG_COPY);
+    _head = emptyString;
+  }
+  const size_t sent = len ? client->add(reinterpret_cast<const char *>(data), len, ASYNC_WRITE_FLAG_COPY) : 0;
+  written += sent;
+
+  if (written) {
+    client->send();
+    _writtenLength += written;
+    request->_server->_sendConsume(request, written);
+#if ASYNCWEBSERVER_USE_CHUNK_INFLIGHT
+    _in_flight += written;
+    --_in_flight_credit;  // take a credit
+#endif
+  }
+
+  _sentLength += sent;
+  if (_sentLength == _contentLength) {
+    _state = RESPONSE_WAIT_ACK;
+  }
+  return written;
+}
+
 size_t AsyncAbstractResponse::_readDataFromCacheOrContent(uint8_t *data, const size_t len) {
   // If we have something in cache, copy it to buffer
   const size_t readFromCache = std::min(len, _cache.size());
@@ -514,6 +710,10 @@ size_t AsyncAbstractResponse::_readDataFromCacheOrContent(uint8_t *data, const s
   // If we need to read more...
   const size_t needFromFile = len - readFromCache;
   const size_t readFromContent = _fillBuffer(data + readFromCache, needFromFile);
+  if (readFromContent == RESPONSE_TRY_AGAIN) {
+    // source is not ready yet: only report it if there was nothing in cache
+    return readFromCache ? readFromCache : RESPONSE_TRY_AGAIN;
+  }
   return readFromCache + readFromContent;
 }
 
@@ -522,8 +722,17 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t *data, size
     return _fillBuffer(data, len);
   }
 
+  // look-ahead reads done while parsing placeholders treat a source not ready as a source with no more data
+  auto readMore = [this](uint8_t *data, const size_t len) -> size_t {
+    const size_t read = _readDataFromCacheOrContent(data, len);
+    return read == RESPONSE_TRY_AGAIN ? 0 : read;
+  };
+
   const size_t originalLen = len;
   len = _readDataFromCacheOrContent(data, len);
+  if (len == RESPONSE_TRY_AGAIN) {
+    return RESPONSE_TRY_AGAIN;
+  }
   // Now we've read 'len' bytes, either from cache or from file
   // Search for template placeholders
   uint8_t *pTemplateStart = data;
@@ -545,14 +754,14 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t *data, size
       } else {  // double percent sign encountered, this is single percent sign escaped.
         // remove the 2nd percent sign
         memmove(pTemplateEnd, pTemplateEnd + 1, &data[len] - pTemplateEnd - 1);
-        len += _readDataFromCacheOrContent(&data[len - 1], 1) - 1;
+        len += readMore(&data[len - 1], 1) - 1;
         ++pTemplateStart;
       }
     } else if (&data[len - 1] - pTemplateStart + 1
                < TEMPLATE_PARAM_NAME_LENGTH + 2) {  // closing placeholder not found, check if it's in the remaining file data
       memcpy(buf, pTemplateStart + 1, &data[len - 1] - pTemplateStart);
       const size_t readFromCacheOrContent =
-        _readDataFromCacheOrContent(buf + (&data[len - 1] - pTemplateStart), TEMPLATE_PARAM_NAME_LENGTH + 2 - (&data[len - 1] - pTemplateStart + 1));
+        readMore(buf + (&data[len - 1] - pTemplateStart), TEMPLATE_PARAM_NAME_LENGTH + 2 - (&data[len - 1] - pTemplateStart + 1));
       if (readFromCacheOrContent) {
         pTemplateEnd = (uint8_t *)memchr(buf + (&data[len - 1] - pTemplateStart), TEMPLATE_PLACEHOLDER, readFromCacheOrContent);
         if (pTemplateEnd) {
@@ -605,7 +814,7 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t *data, size
         // there is some free room, fill it from cache
         const size_t roomFreed = pTemplateEnd + 1 - pTemplateStart - numBytesCopied;
         const size_t totalFreeRoom = originalLen - len + roomFreed;
-        len += _readDataFromCacheOrContent(&data[len - roomFreed], totalFreeRoom) - roomFreed;
+        len += readMore(&data[len - roomFreed], totalFreeRoom) - roomFreed;
       } else {  // result is copied fully; it is longer than placeholder text
         const size_t roomTaken = pTemplateStart + numBytesCopied - pTemplateEnd - 1;
         len = std::min(len + roomTaken, originalLen);
@@ -615,10 +824,110 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t *data, size
   return len;
 }
 
+/*
+ * MIME types registry
+ * */
+
+AsyncMimeTypes::AsyncMimeTypes() {
+  static constexpr const char *defaults[][2] = {
+    {T__html, T_text_html},
+    {T__htm, T_text_html},
+    {T__css, T_text_css},
+    {T__js, T_application_javascript},
+    {T__json, T_application_json},
+    {T__png, T_image_png},
+    {T__ico, T_image_x_icon},
+    {T__svg, T_image_svg_xml},
+    {T__jpg, T_image_jpeg},
+    {T__gif, T_image_gif},
+    {T__woff2, T_font_woff2},
+    {T__woff, T_font_woff},
+    {T__ttf, T_font_ttf},
+    {T__eot, T_font_eot},
+    {T__xml, T_text_xml},
+    {T__pdf, T_application_pdf},
+    {T__zip, T_application_zip},
+    {T__gz, T_application_x_gzip},
+  };
+  _table.resize(32);
+  for (const auto &type : defaults) {
+    add(type[0], type[1]);
+  }
+}
+
+// FNV-1a of the lower case extension
+uint32_t AsyncMimeTypes::_hash(const char *extension) {
+  HashPrint hash;
+  while (*extension) {
+    hash.write((uint8_t)tolower(*extension++));
+  }
+  return hash.hash();
+}
+
+void AsyncMimeTypes::_insert(const Entry &entry) {
+  const size_t mask = _table.size() - 1;
+  size_t i = entry.hash & mask;
+  while (_table[i].extension && !(_table[i].hash == entry.hash && strcasecmp(_table[i].extension, entry.extension) == 0)) {
+    i = (i + 1) & mask;
+  }
+  if (!_table[i].extension) {
+    _count++;
+  }
+  _table[i] = entry;
+}
+
+void AsyncMimeTypes::add(const char *extension, const char *contentType) {
+  if (!extension || !contentType) {
+    return;
+  }
+  // keep the load factor under 1/2
+  if ((_count + 1) * 2 > _table.size()) {
+    std::vector<Entry> old(_table.size() * 2, Entry{0, nullptr, nullptr});
+    old.swap(_table);
+    _count = 0;
+    for (const Entry &entry : old) {
+      if (entry.extension) {
+        _insert(entry);
+      }
+    }
+  }
+  _insert({_hash(extension), extension, contentType});
+}
+
+const char *AsyncMimeTypes::find(const char *extension) const {
+  const uint32_t hash = _hash(extension);
+  const size_t mask = _table.size() - 1;
+  for (size_t i = hash & mask; _table[i].extension; i = (i + 1) & mask) {
+    if (_table[i].hash == hash && strcasecmp(_table[i].extension, extension) == 0) {
+      return _table[i].contentType;
+    }
+  }
+  return nullptr;
+}
+
+const char *AsyncMimeTypes::get(const char *path) const {
+  const char *dot = strrchr(path, '.');
+  const char *contentType = dot ? find(dot) : nullptr;
+  return contentType ? contentType : T_text_plain;
+}
+
 /*
  * File Response
  * */
 
+static String contentTypeFromPath(const String &path) {
+#if HAVE_EXTERN_GET_Content_Type_FUNCTION
+#ifndef ESP8266
+  extern const char *getContentType(const String &path);
+#else
+  extern const __FlashStringHelper *getContentType(const String &path);
+#endif
+  return getContentType(path);
+#else
+  return AsyncMimeTypes::Instance().get(path.c_str());
+#endif
+}
+
 /**
  * @brief Sets the content type based on the file path extension
  *
@@ -630,60 +939,7 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t *data, size
  * @note The method modifies the internal _contentType member variable
  */
 void AsyncFileResponse::_setContentTypeFromPath(const String &path) {
-#if HAVE_EXTERN_GET_Content_Type_FUNCTION
-#ifndef ESP8266
-  extern const char *getContentType(const String &path);
-#else
-  extern const __FlashStringHelper *getContentType(const String &path);
-#endif
-  _contentType = getContentType(path);
-#else
-  const char *cpath = path.c_str();
-  const char *dot = strrchr(cpath, '.');
-
-  if (!dot) {
-    _contentType = T_text_plain;
-    return;
-  }
-
-  if (strcmp(dot, T__html) == 0 || strcmp(dot, T__htm) == 0) {
-    _contentType = T_text_html;
-  } else if (strcmp(dot, T__css) == 0) {
-    _contentType = T_text_css;
-  } else if (strcmp(dot, T__js) == 0) {
-    _contentType = T_application_javascript;
-  } else if (strcmp(dot, T__json) == 0) {
-    _contentType = T_application_json;
-  } else if (strcmp(dot, T__png) == 0) {
-    _contentType = T_image_png;
-  } else if (strcmp(dot, T__ico) == 0) {
-    _contentType = T_image_x_icon;
-  } else if (strcmp(dot, T__svg) == 0) {
-    _contentType = T_image_svg_xml;
-  } else if (strcmp(dot, T__jpg) == 0) {
-    _contentType = T_image_jpeg;
-  } else if (strcmp(dot, T__gif) == 0) {
-    _contentType = T_image_gif;
-  } else if (strcmp(dot, T__woff2) == 0) {
-    _contentType = T_font_woff2;
-  } else if (strcmp(dot, T__woff) == 0) {
-    _contentType = T_font_woff;
-  } else if (strcmp(dot, T__ttf) == 0) {
-    _contentType = T_font_ttf;
-  } else if (strcmp(dot, T__eot) == 0) {
-    _contentType = T_font_eot;
-  } else if (strcmp(dot, T__xml) == 0) {
-    _contentType = T_text_xml;
-  } else if (strcmp(dot, T__pdf) == 0) {
-    _contentType = T_application_pdf;
-  } else if (strcmp(dot, T__zip) == 0) {
-    _contentType = T_application_zip;
-  } else if (strcmp(dot, T__gz) == 0) {
-    _contentType = T_application_x_gzip;
-  } else {
-    _contentType = T_text_plain;
-  }
-#endif
+  _contentType = contentTypeFromPath(path);
 }
 
 /**
@@ -760,11 +1016,20 @@ AsyncFileResponse::AsyncFileResponse(File content, const String &path, const cha
   _code = 200;
   _path = path;
 
-  if (!download && String(content.name()).endsWith(T__gz) && !path.endsWith(T__gz)) {
-    addHeader(T_Content_Encoding, T_gzip, false);
-    _callback = nullptr;  // Unable to process gzipped templates
-    _sendContentLength = true;
-    _chunked = false;
+  if (!download) {
+    String name(content.name());
+    const char *encoding = nullptr;
+    if (name.endsWith(T__gz) && !path.endsWith(T__gz)) {
+      encoding = T_gzip;
+    } else if (name.endsWith(T__br) && !path.endsWith(T__br)) {
+      encoding = T_br;
+    }
+    if (encoding) {
+      addHeader(T_Content_Encoding, encoding, false);
+      _callback = nullptr;  // Unable to process compressed templates
+      _sendContentLength = true;
+      _chunked = false;
+    }
   }
 
   _content = content;
@@ -788,10 +1053,372 @@ AsyncFileResponse::AsyncFileResponse(File content, const String &path, const cha
   addHeader(T_Content_Disposition, buf, false);
 }
 
+#ifdef ESP32
+/*
+ * Background file reader: blocks of the file are read by a storage task into a ring of buffers,
+ * the TCP task only copies the blocks already read.
+ * */
+
+class AsyncFileReadAhead {
+public:
+  enum BlockState : uint8_t {
+    BLOCK_FREE,
+    BLOCK_QUEUED,
+    BLOCK_READY
+  };
+
+  struct Block {
+    std::atomic<uint8_t> state{BLOCK_FREE};
+    size_t length{0};
+    std::unique_ptr<uint8_t[]> data;
+  };
+
+  // queued to the storage task, keeps the reader alive until the block is read
+  struct ReadJob {
+    std::shared_ptr<AsyncFileReadAhead> reader;
+    size_t index;
+  };
+
+  AsyncFileReadAhead(fs::File file, size_t blockSize, size_t count) : _file(file), _blockSize(blockSize), _count(count) {}
+  ~AsyncFileReadAhead() {
+    _file.close();
+  }
+
+  bool begin() {
+    _blocks.reset(new (std::nothrow) Block[_count]);
+    if (!_blocks) {
+      return false;
+    }
+    for (size_t i = 0; i < _count; i++) {
+      _blocks[i].data.reset(new (std::nothrow) uint8_t[_blockSize]);
+      if (!_blocks[i].data) {
+        return false;
+      }
+    }
+    return _worker() != nullptr;
+  }
+
+  // called by the response when it is destroyed: the blocks still queued are skipped
+  void cancel() {
+    _cancelled = true;
+  }
+
+  // queue the free blocks, in the ring order so that the file is read sequentially
+  void queue(const std::shared_ptr<AsyncFileReadAhead> &self) {
+    while (!_eof && _blocks[_queueIndex].state.load() == BLOCK_FREE) {
+      ReadJob *job = new (std::nothrow) ReadJob{self, _queueIndex};
+      if (!job) {
+        return;
+      }
+      _blocks[_queueIndex].state = BLOCK_QUEUED;
+      if (xQueueSend(_worker(), &job, 0) != pdTRUE) {
+        // queue is full, retried on the next read
+        _blocks[_queueIndex].state = BLOCK_FREE;
+        delete job;
+        return;
+      }
+      _queueIndex = (_queueIndex + 1) % _count;
+    }
+  }
+
+  size_t read(const std::shared_ptr<AsyncFileReadAhead> &self, uint8_t *data, size_t len) {
+    size_t outLen = 0;
+    while (outLen < len && !_eof) {
+      Block &block = _blocks[_readIndex];
+      if (block.state.load() != BLOCK_READY) {
+        break;
+      }
+      if (!block.length) {
+        // empty block: end of file
+        _eof = true;
+        break;
+      }
+      const size_t chunk = std::min(len - outLen, block.length - _readOffset);
+      memcpy(data + outLen, block.data.get() + _readOffset, chunk);
+      outLen += chunk;
+      _readOffset += chunk;
+      if (_readOffset == block.length) {
+        _readOffset = 0;
+        block.state = BLOCK_FREE;
+        _readIndex = (_readIndex + 1) % _count;
+      }
+    }
+    queue(self);
+    return (outLen || _eof) ? outLen : RESPONSE_TRY_AGAIN;
+  }
+
+private:
+  fs::File _file;
+  const size_t _blockSize;
+  const size_t _count;
+  std::unique_ptr<Block[]> _blocks;
+  std::atomic<bool> _cancelled{false};
+  // only used by the TCP task
+  size_t _queueIndex{0};
+  size_t _readIndex{0};
+  size_t _readOffset{0};
+  bool _eof{false};
+
+  void _readBlock(size_t index) {
+    Block &block = _blocks[index];
+    block.length = 0;
+    if (!_cancelled) {
+      const int read = _file.read(block.data.get(), _blockSize);
+      block.length = read > 0 ? read : 0;
+    }
+    block.state = BLOCK_READY;
+  }
+
+  static void _task(void *queue) {
+    ReadJob *job;
+    for (;;) {
+      if (xQueueReceive(static_cast<QueueHandle_t>(queue), &job, portMAX_DELAY) == pdTRUE) {
+        job->reader->_readBlock(job->index);
+        // the last job of a cancelled response releases it (and closes the file) here
+        delete job;
+      }
+    }
+  }
+
+  // storage task shared by all the responses, started on first use
+  static QueueHandle_t _worker() {
+    static QueueHandle_t queue = []() -> QueueHandle_t {
+      QueueHandle_t q = xQueueCreate(ASYNCWEBSERVER_READ_AHEAD_QUEUE_LENGTH, sizeof(ReadJob *));
+      if (!q) {
+        return nullptr;
+      }
+      if (xTaskCreate(_task, "async_read", ASYNCWEBSERVER_READ_AHEAD_TASK_STACK, q, ASYNCWEBSERVER_READ_AHEAD_TASK_PRIORITY, nullptr) != pdPASS) {
+        log_e("Failed to create the read-ahead task");
+        return nullptr;
+      }
+      return q;
+    }();
+    return queue;
+  }
+};
+#endif
+
+AsyncFileResponse::~AsyncFileResponse() {
+#ifdef ESP32
+  if (_readAhead) {
+    _readAhead->cancel();
+  }
+#endif
+  _content.close();
+}
+
+void AsyncFileResponse::setContentImage(std::shared_ptr<uint8_t> image) {
+  _image = image;
+  _readLength = 0;
+  if (_image) {
+    _content.close();
+#ifdef ESP32
+    if (_readAhead) {
+      _readAhead->cancel();
+      _readAhead.reset();
+    }
+#endif
+  }
+}
+
+bool AsyncFileResponse::setReadAhead(size_t blockSize, size_t blocks) {
+#ifdef ESP32
+  // templates look ahead in the content, which must then be read synchronously
+  if (_started() || _image || _callback || !_content || !blockSize || blocks < 2) {
+    return false;
+  }
+  std::shared_ptr<AsyncFileReadAhead> readAhead = std::make_shared<AsyncFileReadAhead>(_content, blockSize, blocks);
+  if (!readAhead->begin()) {
+    log_e("Failed to allocate");
+    return false;
+  }
+  // the file now belongs to the reader, the first blocks are read while the head is sent
+  _content = File();
+  _readAhead = readAhead;
+  _readAhead->queue(_readAhead);
+  return true;
+#else
+  (void)blockSize;
+  (void)blocks;
+  return false;
+#endif
+}
+
 size_t AsyncFileResponse::_fillBuffer(uint8_t *data, size_t len) {
+#ifdef ESP32
+  if (_readAhead) {
+    return _readAhead->read(_readAhead, data, len);
+  }
+#endif
+  if (_image) {
+    size_t left = _contentLength - _readLength;
+    if (left > len) {
+      left = len;
+    }
+    memcpy(data, _image.get() + _readLength, left);
+    _readLength += left;
+    return left;
+  }
   return _content.read(data, len);
 }
 
+const uint8_t *AsyncFileResponse::_contentSpan(size_t index, size_t &len) const {
+  if (!_image || index >= _contentLength) {
+    return nullptr;
+  }
+  len = _contentLength - index;
+  return _image.get() + index;
+}
+
+/*
+ * Mapped Response
+ * */
+
+AsyncMappedResponse::AsyncMappedResponse(const AsyncMappedRegion &region, const String &path, const char *contentType, bool download, AwsTemplateProcessor callback)
+  : AsyncAbstractResponse(callback), _region(region) {
+  _code = 200;
+  if (!_callback) {
+    _contentLength = _region.length;
+    // the content is addressable, any part of it can be sent
+    addHeader(T_Accept_Ranges, T_bytes, false);
+  }
+
+  if (path.endsWith(T__gz)) {
+    addHeader(T_Content_Encoding, T_gzip, false);
+  } else if (path.endsWith(T__br)) {
+    addHeader(T_Content_Encoding, T_br, false);
+  }
+
+  if (strlen(contentType) == 0) {
+    _contentType = contentTypeFromPath(path);
+  } else {
+    _contentType = contentType;
+  }
+
+  int filenameStart = path.lastIndexOf('/') + 1;
+  char buf[26 + path.length() - filenameStart];
+  char *filename = (char *)path.c_str() + filenameStart;
+
+  if (download) {
+    snprintf_P(buf, sizeof(buf), PSTR("attachment; filename=\"%s\""), filename);
+  } else {
+    snprintf_P(buf, sizeof(buf), PSTR("inline"));
+  }
+  addHeader(T_Content_Disposition, buf, false);
+}
+
+AsyncMappedResponse::~AsyncMappedResponse() {
+  if (_region.release) {
+    _region.release();
+  }
+}
+
+#ifdef ESP32
+bool AsyncMappedResponse::mapPartition(const esp_partition_t *partition, AsyncMappedRegion &region) {
+  const void *data = nullptr;
+#if ESP_IDF_VERSION_MAJOR < 5
+  spi_flash_mmap_handle_t handle;
+  if (!partition || esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &data, &handle) != ESP_OK) {
+    return false;
+  }
+  region.release = [handle]() {
+    spi_flash_munmap(handle);
+  };
+#else
+  esp_partition_mmap_handle_t handle;
+  if (!partition || esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &data, &handle) != ESP_OK) {
+    return false;
+  }
+  region.release = [handle]() {
+    esp_partition_munmap(handle);
+  };
+#endif
+  region.data = static_cast<const uint8_t *>(data);
+  region.length = partition->size;
+  return true;
+}
+#endif
+
+void AsyncMappedResponse::_respond(AsyncWebServerRequest *request) {
+  // If-Range is not evaluated: the whole content is sent, as allowed by RFC 9110
+  if (_code == 200 && !_callback && request->method() == HTTP_GET && request->hasHeader(T_Range) && !request->hasHeader(T_If_Range)) {
+    _applyRange(request->header(T_Range));
+  }
+  AsyncAbstractResponse::_respond(request);
+}
+
+void AsyncMappedResponse::_applyRange(const String &range) {
+  // only a single range is supported ("bytes=first-last", "bytes=first-" or "bytes=-suffix"),
+  // the whole content is sent for multiple or malformed ranges
+  const size_t prefixLen = strlen(T_bytes);
+  if (!range.startsWith(T_bytes) || range.charAt(prefixLen) != '=' || range.indexOf(',') >= 0) {
+    return;
+  }
+  const char *spec = range.c_str() + prefixLen + 1;
+  const char *dash = strchr(spec, '-');
+  if (!dash || (dash == spec && !isdigit(dash[1]))) {
+    return;
+  }
+
+  char *end;
+  const size_t total = _region.length;
+  size_t first;
+  size_t last = total ? total - 1 : 0;
+  bool satisfiable;
+  if (dash == spec) {
+    const size_t suffix = strtoul(dash + 1, &end, 10);
+    if (*end) {
+      return;
+    }
+    satisfiable = suffix && total;
+    first = suffix < total ? total - suffix : 0;
+  } else {
+    first = strtoul(spec, &end, 10);
+    if (end != dash) {
+      return;
+    }
+    if (dash[1]) {
+      const size_t requestedLast = strtoul(dash + 1, &end, 10);
+      if (*end || requestedLast < first) {
+        return;
+      }
+      last = std::min(last, requestedLast);
+    }
+    satisfiable = first < total;
+  }
+
+  if (!satisfiable) {
+    _code = 416;
+    _contentLength = 0;
+    addHeader(T_Content_Range, String(T_bytes) + " */" + String(total));
+    return;
+  }
+  _code = 206;
+  _offset = first;
+  _contentLength = last - first + 1;
+  addHeader(T_Content_Range, String(T_bytes) + ' ' + String(first) + '-' + String(last) + '/' + String(total));
+}
+
+size_t AsyncMappedResponse::_fillBuffer(uint8_t *data, size_t len) {
+  const size_t left = _region.length - _offset - _readLength;
+  if (len > left) {
+    len = left;
+  }
+  if (len) {
+    memcpy(data, _region.data + _offset + _readLength, len);
+  }
+  _readLength += len;
+  return len;
+}
+
+const uint8_t *AsyncMappedResponse::_contentSpan(size_t index, size_t &len) const {
+  if (index >= _contentLength) {
+    return nullptr;
+  }
+  len = _contentLength - index;
+  return _region.data + _offset + index;
+}
+
 /*
  * Stream Response
  * */
@@ -803,12 +1430,96 @@ AsyncStreamResponse::AsyncStreamResponse(Stream &stream, const char *contentType
   _contentType = contentType;
 }
 
+AsyncStreamResponse::AsyncStreamResponse(Stream &stream, const char *contentType, AwsStreamCompletion completion, AwsTemplateProcessor callback)
+  : AsyncAbstractResponse(callback) {
+  _code = 200;
+  _content = &stream;
+  _completion = completion;
+  _contentLength = 0;
+  _contentType = contentType;
+  _sendContentLength = false;
+  _chunked = true;
+}
+
+bool AsyncStreamResponse::setReadAhead(size_t bufferSize) {
+  if (_started()) {
+    return false;
+  }
+  _readAheadStart = 0;
+  _readAheadLength = 0;
+  _readAheadSize = 0;
+  _readAhead.reset();
+  if (!bufferSize) {
+    return true;
+  }
+  _readAhead.reset(new (std::nothrow) uint8_t[bufferSize]);
+  if (!_readAhead) {
+#ifdef ESP32
+    log_e("Failed to allocate");
+#endif
+    return false;
+  }
+  _readAheadSize = bufferSize;
+  return true;
+}
+
+size_t AsyncStreamResponse::_readStream(uint8_t *data, size_t len) {
+  // available() is often pessimistic (only what is in the driver buffer, or clipped): keep on reading until it reports nothing
+  size_t outLen = 0;
+  while (outLen < len) {
+    const int available = _content->available();
+    if (available <= 0) {
+      break;
+    }
+    const size_t read = _content->readBytes(data + outLen, std::min(len - outLen, static_cast<size_t>(available)));
+    if (!read) {
+      break;
+    }
+    outLen += read;
+  }
+  return outLen;
+}
+
+void AsyncStreamResponse::_fillReadAhead() {
+  // fill the free space of the ring, which is at most 2 contiguous areas
+  while (_readAheadLength < _readAheadSize) {
+    const size_t end = (_readAheadStart + _readAheadLength) % _readAheadSize;
+    size_t room = (end >= _readAheadStart) ? _readAheadSize - end : _readAheadStart - end;
+    if (_contentLength) {
+      // never read past the content: the rest of the stream (i.e. a serial port) belongs to the application
+      const size_t consumed = _readLength + _readAheadLength;
+      room = std::min(room, _contentLength > consumed ? _contentLength - consumed : 0);
+      if (!room) {
+        break;
+      }
+    }
+    const size_t read = _readStream(_readAhead.get() + end, room);
+    _readAheadLength += read;
+    if (read < room) {
+      break;
+    }
+  }
+}
+
 size_t AsyncStreamResponse::_fillBuffer(uint8_t *data, size_t len) {
-  size_t available = _content->available();
-  size_t outLen = (available > len) ? len : available;
-  size_t i;
-  for (i = 0; i < outLen; i++) {
-    data[i] = _content->read();
+  size_t outLen = 0;
+  if (_readAhead) {
+    _fillReadAhead();
+    while (outLen < len && _readAheadLength) {
+      const size_t chunk = std::min({len - outLen, _readAheadLength, _readAheadSize - _readAheadStart});
+      memcpy(data + outLen, _readAhead.get() + _readAheadStart, chunk);
+      outLen += chunk;
+      _readAheadLength -= chunk;
+      _readAheadStart = _readAheadLength ? (_readAheadStart + chunk) % _readAheadSize : 0;
+    }
+  } else {
+    outLen = _readStream(data, len);
+  }
+  _readLength += outLen;
+
+  // nothing to send yet but the stream is not finished: ask to be called again later
+  if (!outLen && _completion && !_completion(*_content, _readLength)) {
+    return RESPONSE_TRY_AGAIN;
   }
   return outLen;
 }
@@ -885,6 +1596,72 @@ size_t AsyncProgmemResponse::_fillBuffer(uint8_t *data, size_t len) {
   return left;
 }
 
+bool AsyncProgmemResponse::_contentHash(uint32_t &hash) {
+  if (_callback || !_content) {
+    return false;
+  }
+  HashPrint hashPrint;
+  for (size_t i = 0; i < _contentLength; i++) {
+    hashPrint.write(pgm_read_byte(_content + i));
+  }
+  hash = hashPrint.hash();
+  return true;
+}
+
+bool AsyncProgmemResponse::_contentPrint(Print &out) {
+  if (_callback || !_content) {
+    return false;
+  }
+  for (size_t i = 0; i < _contentLength; i++) {
+    out.write(pgm_read_byte(_content + i));
+  }
+  return true;
+}
+
+const uint8_t *AsyncProgmemResponse::_contentSpan(size_t index, size_t &len) const {
+#ifdef ESP8266
+  // flash is not byte-addressable: content has to be read with memcpy_P()
+  (void)index;
+  (void)len;
+  return nullptr;
+#else
+  if (!_content || index > _contentLength) {
+    return nullptr;
+  }
+  len = _contentLength - index;
+  return _content + index;
+#endif
+}
+
+/*
+ * Shared Response
+ * */
+
+AsyncSharedResponse::AsyncSharedResponse(int code, const char *contentType, std::shared_ptr<const String> content)
+  : _content(std::move(content)), _readLength(0) {
+  _code = code;
+  _contentType = contentType;
+  _contentLength = _content ? _content->length() : 0;
+}
+
+size_t AsyncSharedResponse::_fillBuffer(uint8_t *data, size_t len) {
+  size_t left = _contentLength - _readLength;
+  if (left > len) {
+    left = len;
+  }
+  memcpy(data, _content->c_str() + _readLength, left);
+  _readLength += left;
+  return left;
+}
+
+const uint8_t *AsyncSharedResponse::_contentSpan(size_t index, size_t &len) const {
+  if (!_content || index > _contentLength) {
+    return nullptr;
+  }
+  len = _contentLength - index;
+  return reinterpret_cast<const uint8_t *>(_content->c_str()) + index;
+}
+
 /*
  * Response Stream (You can print/write/printf to it, up to the contentLen bytes)
  * */
@@ -906,6 +1683,26 @@ size_t AsyncResponseStream::_fillBuffer(uint8_t *buf, size_t maxLen) {
   return _content->read((char *)buf, maxLen);
 }
 
+bool AsyncResponseStream::_contentPrint(Print &out) {
+  if (_started()) {
+    return false;
+  }
+  // the buffer is only peeked: its content is still sent afterwards
+  size_t len = _content->available();
+  if (!len) {
+    return true;
+  }
+  std::unique_ptr<char[]> data(new (std::nothrow) char[len]);
+  if (!data) {
+#ifdef ESP32
+    log_e("Failed to allocate");
+#endif
+    return false;
+  }
+  out.write(reinterpret_cast<const uint8_t *>(data.get()), _content->peek(data.get(), len));
+  return true;
+}
+
 size_t AsyncResponseStream::write(const uint8_t *data, size_t len) {
   if (_started()) {
     return 0;
@@ -923,6 +1720,7 @@ size_t AsyncResponseStream::write(const uint8_t *data, size_t len) {
     }
   }
   size_t written = _content->write((const char *)data, len);
+  _hash.write(data, written);
   _contentLength += written;
   return written;
 }
@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+#include "WebRouter.h"
+#include "HashPrint.h"
+
+bool AsyncWebRoute::matches(const String &url) const {
+  const char *u = url.c_str();
+  const size_t len = url.length();
+  switch (kind) {
+    case ROUTE_EXACT:     return len == length && memcmp(u, path, length) == 0;
+    case ROUTE_SEGMENT:   return len >= length && memcmp(u, path, length) == 0 && (len == length || u[length] == '/');
+    case ROUTE_PREFIX:    return len >= length && memcmp(u, path, length) == 0;
+    case ROUTE_EXTENSION: return len >= length && memcmp(u + len - length, path, length) == 0;
+    default:              return true;
+  }
+}
+
+AsyncWebRouter::AsyncWebRouter(const std::list<std::shared_ptr<AsyncWebHandler>> &handlers, const std::list<std::shared_ptr<AsyncWebRewrite>> &rewrites)
+  : _handlers(handlers.begin(), handlers.end()), _rewrites(rewrites.begin(), rewrites.end()) {
+  _build();
+  _buildRewrites();
+}
+
+void AsyncWebRouter::_build() {
+  _candidates.reserve(_handlers.size());
+
+  size_t order = 0;
+  for (const auto &h : _handlers) {
+    const AsyncWebRoute route = h->route();
+    const Entry entry = {h.get(), order++, route.kind, route.methods};
+    switch (route.kind) {
+      case ROUTE_EXACT:
+      case ROUTE_SEGMENT:
+      case ROUTE_PREFIX:    _insert(_root, route.path, route.length, entry); break;
+      case ROUTE_EXTENSION: _extensions.push_back({String(route.path, route.length), entry}); break;
+      default:              _any.push_back(entry); break;
+    }
+  }
+}
+
+void AsyncWebRouter::_insert(Node &node, const char *path, size_t length, const Entry &entry) {
+  node.methods |= entry.methods;
+  if (!length) {
+    node.entries.push_back(entry);
+    return;
+  }
+  for (Node &child : node.children) {
+    const size_t labelLen = child.label.length();
+    size_t common = 0;
+    while (common < labelLen && common < length && child.label[common] == path[common]) {
+      common++;
+    }
+    if (!common) {
+      continue;
+    }
+    if (common < labelLen) {
+      // split the edge: the child keeps the common part, its content moves below
+      Node tail;
+      tail.label = child.label.substring(common);
+      tail.methods = child.methods;
+      tail.entries = std::move(child.entries);
+      tail.children = std::move(child.children);
+      child.label = child.label.substring(0, common);
+      child.entries.clear();
+      child.children.clear();
+      child.children.push_back(std::move(tail));
+    }
+    _insert(child, path + common, length - common, entry);
+    return;
+  }
+  Node leaf = {};
+  leaf.label = String(path, length);
+  node.children.push_back(std::move(leaf));
+  _insert(node.children.back(), path + length, 0, entry);
+}
+
+void AsyncWebRouter::_candidate(AsyncWebServerRequest *request, const Entry &entry) {
+  if (request->methodMatches(entry.methods)) {
+    _candidates.push_back(&entry);
+  }
+}
+
+AsyncWebHandler *AsyncWebRouter::match(AsyncWebServerRequest *request) {
+  _candidates.clear();
+
+  // walk the tree along the URL: each node reached is a prefix of the URL
+  const char *url = request->url().c_str();
+  const size_t len = request->url().length();
+  const Node *node = &_root;
+  size_t pos = 0;
+  while (node && request->methodMatches(node->methods)) {
+    for (const Entry &entry : node->entries) {
+      if (entry.kind == ROUTE_PREFIX || pos == len || (entry.kind == ROUTE_SEGMENT && url[pos] == '/')) {
+        _candidate(request, entry);
+      }
+    }
+    const Node *next = nullptr;
+    if (pos < len) {
+      for (const Node &child : node->children) {
+        const size_t labelLen = child.label.length();
+        if (child.label[0] == url[pos]) {
+          if (labelLen <= len - pos && memcmp(child.label.c_str(), url + pos, labelLen) == 0) {
+            next = &child;
+            pos += labelLen;
+          }
+          break;
+        }
+      }
+    }
+    node = next;
+  }
+
+  for (const Extension &extension : _extensions) {
+    const size_t extLen = extension.suffix.length();
+    if (len >= extLen && memcmp(url + len - extLen, extension.suffix.c_str(), extLen) == 0) {
+      _candidate(request, extension.entry);
+    }
+  }
+  for (const Entry &entry : _any) {
+    _candidate(request, entry);
+  }
+
+  // same precedence as before: the first handler added wins
+  std::sort(_candidates.begin(), _candidates.end(), [](const Entry *a, const Entry *b) {
+    return a->order < b->order;
+  });
+  for (const Entry *entry : _candidates) {
+    if (entry->handler->filter(request) && entry->handler->canHandle(request)) {
+      return entry->handler;
+    }
+  }
+  return nullptr;
+}
+
+void AsyncWebRouter::_buildRewrites() {
+  _rewriteCandidates.reserve(_rewrites.size());
+
+  size_t order = 0;
+  for (const auto &r : _rewrites) {
+    const AsyncWebRoute route = r->route();
+    Rewrite rewrite = {r.get(), order++, 0, -1};
+    switch (route.kind) {
+      case ROUTE_EXACT:
+        rewrite.hash = HashPrint::hash((const uint8_t *)route.path, route.length);
+        _exactRewrites.push_back(rewrite);
+        break;
+      case ROUTE_PREFIX: _insertRewrite(_prefixRewrites, route.path, route.length, rewrite); break;
+      default:           _otherRewrites.push_back(rewrite); break;
+    }
+  }
+
+  // power of 2 buckets, at most half full
+  size_t size = _exactRewrites.empty() ? 0 : 2;
+  while (size < 2 * _exactRewrites.size()) {
+    size *= 2;
+  }
+  _rewriteBuckets.assign(size, -1);
+  // chained from the last one so that each bucket lists its rewrites in order
+  for (int i = (int)_exactRewrites.size() - 1; i >= 0; i--) {
+    int &head = _rewriteBuckets[_exactRewrites[i].hash & (size - 1)];
+    _exactRewrites[i].next = head;
+    head = i;
+  }
+}
+
+void AsyncWebRouter::_insertRewrite(RewriteNode &node, const char *path, size_t length, const Rewrite &rewrite) {
+  if (!length) {
+    node.rewrites.push_back(rewrite);
+    return;
+  }
+  for (RewriteNode &child : node.children) {
+    const size_t labelLen = child.label.length();
+    size_t common = 0;
+    while (common < labelLen && common < length && child.label[common] == path[common]) {
+      common++;
+    }
+    if (!common) {
+      continue;
+    }
+    if (common < labelLen) {
+      RewriteNode tail;
+      tail.label = child.label.substring(common);
+      tail.rewrites = std::move(child.rewrites);
+      tail.children = std::move(child.children);
+      child.label = child.label.substring(0, common);
+      child.rewrites.clear();
+      child.children.clear();
+      child.children.push_back(std::move(tail));
+    }
+    _insertRewrite(child, path + common, length - common, rewrite);
+    return;
+  }
+  RewriteNode leaf = {};
+  leaf.label = String(path, length);
+  node.children.push_back(std::move(leaf));
+  _insertRewrite(node.children.back(), path + length, 0, rewrite);
+}
+
+AsyncWebRewrite *AsyncWebRouter::rewrite(AsyncWebServerRequest *request, size_t &next) {
+  _rewriteCandidates.clear();
+  const char *url = request->url().c_str();
+  const size_t len = request->url().length();
+
+  if (!_rewriteBuckets.empty()) {
+    const uint32_t hash = HashPrint::hash((const uint8_t *)url, len);
+    for (int i = _rewriteBuckets[hash & (_rewriteBuckets.size() - 1)]; i >= 0; i = _exactRewrites[i].next) {
+      const Rewrite &r = _exactRewrites[i];
+      if (r.order >= next && r.hash == hash) {
+        _rewriteCandidates.push_back(&r);
+      }
+    }
+  }
+
+  const RewriteNode *node = &_prefixRewrites;
+  size_t pos = 0;
+  while (node) {
+    for (const Rewrite &r : node->rewrites) {
+      if (r.order >= next) {
+        _rewriteCandidates.push_back(&r);
+      }
+    }
+    const RewriteNode *child = nullptr;
+    if (pos < len) {
+      for (const RewriteNode &c : node->children) {
+        if (c.label[0] == url[pos]) {
+          const size_t labelLen = c.label.length();
+          if (labelLen <= len - pos && memcmp(c.label.c_str(), url + pos, labelLen) == 0) {
+            child = &c;
+            pos += labelLen;
+          }
+          break;
+        }
+      }
+    }
+    node = child;
+  }
+
+  for (const Rewrite &r : _otherRewrites) {
+    if (r.order >= next) {
+      _rewriteCandidates.push_back(&r);
+    }
+  }
+
+  std::sort(_rewriteCandidates.begin(), _rewriteCandidates.end(), [](const Rewrite *a, const Rewrite *b) {
+    return a->order < b->order;
+  });
+  for (const Rewrite *r : _rewriteCandidates) {
+    // match() also checks the path against hash collisions, and the filter
+    if (r->rewrite->match(request)) {
+      next = r->order + 1;
+      return r->rewrite;
+    }
+  }
+  return nullptr;
+}
+
+bool AsyncPathPattern::compile(const String &pattern) {
+  _pattern = pattern;
+  _tokens.clear();
+  _captures = 0;
+
+  const char *p = _pattern.c_str();
+  const size_t len = _pattern.length();
+  size_t literal = 0;
+  size_t i = 0;
+  while (i < len) {
+    if (p[i] != '{') {
+      i++;
+      continue;
+    }
+    const char *close = strchr(p + i, '}');
+    if (!close || ++_captures > ASYNCWEBSERVER_PATH_ARGS_MAX) {
+      break;
+    }
+    if (i > literal) {
+      _tokens.push_back({TOKEN_LITERAL, (uint16_t)literal, (uint16_t)(i - literal)});
+    }
+    // {name} or {name:type}
+    const size_t nameStart = i + 1;
+    const size_t end = close - p;
+    const char *colon = (const char *)memchr(p + nameStart, ':', end - nameStart);
+    const size_t nameEnd = colon ? (size_t)(colon - p) : end;
+    TokenType type = TOKEN_SEGMENT;
+    if (colon) {
+      const size_t typeLen = end - nameEnd - 1;
+      if (typeLen == 3 && strncmp(colon + 1, "int", 3) == 0) {
+        type = TOKEN_INT;
+      } else if (typeLen == 1 && colon[1] == '*') {
+        type = TOKEN_REST;
+      } else {
+        break;
+      }
+    }
+    if (nameEnd == nameStart) {
+      break;
+    }
+    _tokens.push_back({type, (uint16_t)nameStart, (uint16_t)(nameEnd - nameStart)});
+    i = end + 1;
+    literal = i;
+  }
+
+  if (i < len || !_captures || len > 0xFFFF) {
+#ifdef ESP32
+    if (_captures) {
+      log_e("Invalid path pattern: %s", p);
+    }
+#endif
+    _tokens.clear();
+    _captures = 0;
+    return false;
+  }
+  if (len > literal) {
+    _tokens.push_back({TOKEN_LITERAL, (uint16_t)literal, (uint16_t)(len - literal)});
+  }
+  return true;
+}
+
+bool AsyncPathPattern::match(const String &url, AsyncPathSpan *spans, size_t &count) const {
+  if (!valid() || url.length() > 0xFFFF || !_match(0, url.c_str(), 0, url.length(), spans, 0)) {
+    return false;
+  }
+  count = _captures;
+  return true;
+}
+
+bool AsyncPathPattern::_match(size_t token, const char *url, size_t pos, size_t len, AsyncPathSpan *spans, size_t capture) const {
+  if (token == _tokens.size()) {
+    return pos == len;
+  }
+  const Token &t = _tokens[token];
+  if (t.type == TOKEN_LITERAL) {
+    return len - pos >= t.length && memcmp(url + pos, _pattern.c_str() + t.start, t.length) == 0
+           && _match(token + 1, url, pos + t.length, len, spans, capture);
+  }
+  // longest capture first, shortened until the rest of the pattern matches
+  size_t end = pos;
+  if (t.type == TOKEN_REST) {
+    end = len;
+  } else {
+    while (end < len && url[end] != '/' && (t.type != TOKEN_INT || isdigit((unsigned char)url[end]))) {
+      end++;
+    }
+  }
+  for (; end > pos; end--) {
+    spans[capture] = {(uint16_t)pos, (uint16_t)(end - pos)};
+    if (_match(token + 1, url, end, len, spans, capture + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int AsyncPathPattern::indexOf(const char *name) const {
+  const size_t len = strlen(name);
+  int index = 0;
+  for (const Token &t : _tokens) {
+    if (t.type == TOKEN_LITERAL) {
+      continue;
+    }
+    if (t.length == len && strncmp(_pattern.c_str() + t.start, name, len) == 0) {
+      return index;
+    }
+    index++;
+  }
+  return -1;
+}
+
+size_t AsyncPathPattern::prefixLength() const {
+  return !_tokens.empty() && _tokens[0].type == TOKEN_LITERAL ? _tokens[0].length : 0;
+}
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+#ifndef ASYNCWEBSERVERROUTER_H_
+#define ASYNCWEBSERVERROUTER_H_
+
+#include "ESPAsyncWebServer.h"
+
+#include <atomic>
+
+/**
+ * @brief Rewrite created by AsyncWebServer::rewrite(): it matches by path, so it is indexed by its route.
+ * A from path ending with '*' rewrites all the URLs starting with it.
+ */
+class AsyncWebPathRewrite final : public AsyncWebRewrite {
+public:
+  AsyncWebPathRewrite(const char *from, const char *to) : AsyncWebRewrite(from, to) {
+    _prefix = _from.endsWith("*");
+  }
+  AsyncWebRoute route() const override {
+    return AsyncWebRoute(_prefix ? ROUTE_PREFIX : ROUTE_EXACT, _from.c_str(), _from.length() - (_prefix ? 1 : 0), HTTP_ANY);
+  }
+  bool match(AsyncWebServerRequest *request) override {
+    return route().matches(request->url()) && filter(request);
+  }
+
+private:
+  bool _prefix;
+};
+
+/**
+ * @brief Routing snapshot of a server: index of the handlers by route (see AsyncWebHandler::route()).
+ * The paths are kept in a radix tree, so that all the handlers whose path matches an URL are found in one walk
+ * along the URL, the extensions and the handlers without route are kept in lists.
+ * Only the handlers whose route and methods match a request are then checked, in the order they were added.
+ * Matching a request does not allocate memory.
+ *
+ * The rewrites are indexed the same way: the exact paths in a hash table, the prefixes in a radix tree and the other
+ * rewrites (subclasses with their own match()) in a list.
+ *
+ * A snapshot is built from the handlers and rewrites of the server and never changes afterwards: when they change,
+ * the server builds a new one and swaps it. The snapshot keeps the handlers and rewrites alive, and is itself kept
+ * alive by the server while it is the current one and by each request routed with it, so a handler removed
+ * from another task is only deleted once the requests using it are gone.
+ * Requests are matched on the network task only (match() and rewrite() use a scratch buffer).
+ */
+class AsyncWebRouter {
+public:
+  AsyncWebRouter(const std::list<std::shared_ptr<AsyncWebHandler>> &handlers, const std::list<std::shared_ptr<AsyncWebRewrite>> &rewrites);
+
+  void acquire() {
+    _refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  // deletes the snapshot with its last reference
+  void release() {
+    if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  // first handler accepting the request, nullptr if none
+  AsyncWebHandler *match(AsyncWebServerRequest *request);
+  // first rewrite matching the request whose position is at least next, next is updated to the position after it
+  AsyncWebRewrite *rewrite(AsyncWebServerRequest *request, size_t &next);
+
+private:
+  struct Entry {
+    AsyncWebHandler *handler;
+    size_t order;  // position in the list of handlers
+    AsyncRouteKind kind;
+    WebRequestMethodComposite methods;
+  };
+
+  struct Node {
+    String label;                       // part of the path from the parent node
+    WebRequestMethodComposite methods;  // methods of the entries of this node and below
+    std::vector<Entry> entries;         // handlers whose path ends here
+    std::vector<Node> children;
+  };
+
+  struct Extension {
+    String suffix;
+    Entry entry;
+  };
+
+  struct Rewrite {
+    AsyncWebRewrite *rewrite;
+    size_t order;  // position in the list of rewrites
+    uint32_t hash;
+    int next;  // next rewrite in the same bucket, -1 if none
+  };
+
+  struct RewriteNode {
+    String label;
+    std::vector<Rewrite> rewrites;  // prefixes ending here
+    std::vector<RewriteNode> children;
+  };
+
+  std::atomic<uint32_t> _refs{1};  // the creator holds the first reference
+  std::vector<std::shared_ptr<AsyncWebHandler>> _handlers;
+  std::vector<std::shared_ptr<AsyncWebRewrite>> _rewrites;
+
+  Node _root = {};
+  std::vector<Extension> _extensions;
+  std::vector<Entry> _any;
+  // handlers matching the current request, reserved for all the handlers
+  std::vector<const Entry *> _candidates;
+
+  std::vector<Rewrite> _exactRewrites;
+  std::vector<int> _rewriteBuckets;  // first rewrite of each bucket, -1 if empty
+  RewriteNode _prefixRewrites = {};
+  std::vector<Rewrite> _otherRewrites;
+  std::vector<const Rewrite *> _rewriteCandidates;
+
+  void _build();
+  void _buildRewrites();
+  static void _insert(Node &node, const char *path, size_t length, const Entry &entry);
+  void _candidate(AsyncWebServerRequest *request, const Entry &entry);
+  static void _insertRewrite(RewriteNode &node, const char *path, size_t length, const Rewrite &rewrite);
+};
+
+#endif /* ASYNCWEBSERVERROUTER_H_ */
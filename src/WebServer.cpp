@@ -3,6 +3,7 @@
 
 #include "ESPAsyncWebServer.h"
 #include "WebHandlerImpl.h"
+#include "WebRouter.h"
 
 #if defined(ESP32) || defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350) || defined(LIBRETINY)
 #include <WiFi.h>
@@ -57,17 +58,29 @@ AsyncWebServer::AsyncWebServer(uint16_t port) : _server(port) {
 AsyncWebServer::~AsyncWebServer() {
   reset();
   end();
+  AsyncWebRouter *routes = _routes.exchange(nullptr);
+  if (routes) {
+    routes->release();
+  }
   delete _catchAllHandler;
   _catchAllHandler = nullptr;  // Prevent potential use-after-free
 }
 
 AsyncWebRewrite &AsyncWebServer::addRewrite(std::shared_ptr<AsyncWebRewrite> rewrite) {
+#ifdef ESP32
+  std::lock_guard<std::mutex> lock(_routesLock);
+#endif
   _rewrites.emplace_back(rewrite);
+  _routesChanged = true;
   return *_rewrites.back().get();
 }
 
 AsyncWebRewrite &AsyncWebServer::addRewrite(AsyncWebRewrite *rewrite) {
+#ifdef ESP32
+  std::lock_guard<std::mutex> lock(_routesLock);
+#endif
   _rewrites.emplace_back(rewrite);
+  _routesChanged = true;
   return *_rewrites.back().get();
 }
 
@@ -76,9 +89,13 @@ bool AsyncWebServer::removeRewrite(AsyncWebRewrite *rewrite) {
 }
 
 bool AsyncWebServer::removeRewrite(const char *from, const char *to) {
+#ifdef ESP32
+  std::lock_guard<std::mutex> lock(_routesLock);
+#endif
   for (auto r = _rewrites.begin(); r != _rewrites.end(); ++r) {
     if (r->get()->from() == from && r->get()->toUrl() == to) {
       _rewrites.erase(r);
+      _routesChanged = true;
       return true;
     }
   }
@@ -86,19 +103,31 @@ bool AsyncWebServer::removeRewrite(const char *from, const char *to) {
 }
 
 AsyncWebRewrite &AsyncWebServer::rewrite(const char *from, const char *to) {
-  _rewrites.emplace_back(std::make_shared<AsyncWebRewrite>(from, to));
+#ifdef ESP32
+  std::lock_guard<std::mutex> lock(_routesLock);
+#endif
+  _rewrites.emplace_back(std::make_shared<AsyncWebPathRewrite>(from, to));
+  _routesChanged = true;
   return *_rewrites.back().get();
 }
 
 AsyncWebHandler &AsyncWebServer::addHandler(AsyncWebHandler *handler) {
+#ifdef ESP32
+  std::lock_guard<std::mutex> lock(_routesLock);
+#endif
   _handlers.emplace_back(handler);
+  _routesChanged = true;
   return *(_handlers.back().get());
 }
 
 bool AsyncWebServer::removeHandler(AsyncWebHandler *handler) {
+#ifdef ESP32
+  std::lock_guard<std::mutex> lock(_routesLock);
+#endif
   for (auto i = _handlers.begin(); i != _handlers.end(); ++i) {
     if (i->get() == handler) {
       _handlers.erase(i);
+      _routesChanged = true;
       return true;
     }
   }
@@ -128,23 +157,263 @@ void AsyncWebServer::_handleDisconnect(AsyncWebServerRequest *request) {
   delete request;
 }
 
+// smallest share worth sending: below it, the response waits for the next round (chunked responses need more than 8 bytes)
+static constexpr size_t SEND_MIN_GRANT = 64;
+
+void AsyncWebServer::setSendScheduler(bool enable) {
+  _sendScheduler = enable;
+  if (!enable) {
+    _sendFlows.clear();
+  }
+}
+
+void AsyncWebServer::setSendQuantum(AsyncSendPriority priority, size_t bytes) {
+  if (priority < SEND_PRIORITY_MAX) {
+    _sendQuantum[priority] = std::max(bytes, SEND_MIN_GRANT);
+  }
+}
+
+void AsyncWebServer::setFileMapper(fs::FS &fs, AwsFileMapper mapper) {
+  _fileMappers.remove_if([&fs](const std::pair<fs::FS *, AwsFileMapper> &entry) {
+    return entry.first == &fs;
+  });
+  if (mapper) {
+    _fileMappers.emplace_back(&fs, mapper);
+  }
+}
+
+bool AsyncWebServer::_mapFile(fs::FS &fs, const String &path, AsyncMappedRegion &region) {
+  for (const auto &entry : _fileMappers) {
+    if (entry.first == &fs) {
+      return entry.second(path, region);
+    }
+  }
+  return false;
+}
+
+// headers read by the server, its handlers and middlewares
+static const char *const requiredHeaders[] = {
+  T_ACCEPT, T_Accept_Encoding, T_AUTH, T_Connection, T_Content_Length, T_Content_Type, T_CORS_O, T_EXPECT, T_Host, T_IMS, T_INM, T_If_Match,
+  T_If_Range, T_If_Unmodified_Since, T_Last_Event_ID, T_Range, T_Sec_WebSocket_Key, T_Sec_WebSocket_Protocol, T_Sec_WebSocket_Version, T_UPGRADE,
+};
+
+static uint32_t headerHash(const char *name, size_t len) {
+  HashPrint hash;
+  for (size_t i = 0; i < len; i++) {
+    hash.write((uint8_t)tolower((unsigned char)name[i]));
+  }
+  return hash.hash();
+}
+
+void AsyncWebServer::keepHeader(const char *name) {
+  _keepListedHeaders = true;
+  _addHeaderRule(name, true, false);
+}
+
+void AsyncWebServer::dropHeader(const char *name) {
+  _addHeaderRule(name, false, false);
+}
+
+AsyncWebServer::HeaderRule *AsyncWebServer::_findHeaderRule(const char *name, size_t len, uint32_t hash) {
+  auto it = std::lower_bound(_headerRules.begin(), _headerRules.end(), hash, [](const HeaderRule &rule, uint32_t hash) {
+    return rule.hash < hash;
+  });
+  for (; it != _headerRules.end() && it->hash == hash; ++it) {
+    if (it->name.length() == len && strncasecmp(it->name.c_str(), name, len) == 0) {
+      return &*it;
+    }
+  }
+  return nullptr;
+}
+
+void AsyncWebServer::_addHeaderRule(const char *name, bool keep, bool required) {
+  if (_headerRules.empty() && !required) {
+    for (const char *header : requiredHeaders) {
+      _addHeaderRule(header, true, true);
+    }
+  }
+  const size_t len = strlen(name);
+  const uint32_t hash = headerHash(name, len);
+  HeaderRule *rule = _findHeaderRule(name, len, hash);
+  if (rule) {
+    rule->keep = rule->required || keep;
+    return;
+  }
+  auto it = std::upper_bound(_headerRules.begin(), _headerRules.end(), hash, [](uint32_t hash, const HeaderRule &rule) {
+    return hash < rule.hash;
+  });
+  _headerRules.insert(it, HeaderRule{hash, name, keep, required});
+}
+
+bool AsyncWebServer::_storeHeader(const char *name, size_t len) {
+  if (_headerRules.empty()) {
+    return true;
+  }
+  const HeaderRule *rule = _findHeaderRule(name, len, headerHash(name, len));
+  return rule ? rule->keep : !_keepListedHeaders;
+}
+
+AsyncWebServer::SendFlow *AsyncWebServer::_findSendFlow(AsyncWebServerRequest *request) {
+  for (SendFlow &flow : _sendFlows) {
+    if (flow.request == request) {
+      return &flow;
+    }
+  }
+  return nullptr;
+}
+
+void AsyncWebServer::_sendAttach(AsyncWebServerRequest *request, AsyncSendPriority priority) {
+  if (!_sendScheduler || _findSendFlow(request)) {
+    return;
+  }
+  if (priority >= SEND_PRIORITY_MAX) {
+    priority = SEND_PRIORITY_NORMAL;
+  }
+  if (_sendFlows.empty()) {
+    _sendRoundStart = millis();
+  }
+  // a new response joins the current round with a full quantum
+  _sendFlows.push_back({request, priority, _sendQuantum[priority], false});
+}
+
+void AsyncWebServer::_sendDetach(AsyncWebServerRequest *request) {
+  _sendFlows.remove_if([request](const SendFlow &flow) {
+    return flow.request == request;
+  });
+}
+
+size_t AsyncWebServer::_sendGrant(AsyncWebServerRequest *request, size_t space, bool idle) {
+  SendFlow *flow = _sendScheduler ? _findSendFlow(request) : nullptr;
+  if (!flow) {
+    return space;
+  }
+
+  if (flow->deficit < SEND_MIN_GRANT) {
+    if (idle) {
+      // never leave a connection without anything in flight: it would only be resumed by the next poll
+      flow->deficit += _sendQuantum[flow->priority];
+    } else {
+      flow->waiting = true;
+      if (!_sendKicking) {
+        // the round is over when all the responses have used their share, or when it lasted too long
+        // because some of them are blocked by their connection
+        bool allWaiting = true;
+        for (const SendFlow &f : _sendFlows) {
+          if (!f.waiting) {
+            allWaiting = false;
+            break;
+          }
+        }
+        if (allWaiting || millis() - _sendRoundStart >= ASYNCWEBSERVER_SEND_ROUND_MS) {
+          _nextSendRound(request);
+          // the list may have changed while resuming the other responses
+          flow = _findSendFlow(request);
+        }
+      }
+      if (!flow || flow->waiting) {
+        return 0;
+      }
+    }
+  }
+
+  return std::min(space, flow->deficit);
+}
+
+void AsyncWebServer::_sendConsume(AsyncWebServerRequest *request, size_t len) {
+  SendFlow *flow = _sendScheduler ? _findSendFlow(request) : nullptr;
+  if (flow) {
+    flow->deficit -= std::min(len, flow->deficit);
+  }
+}
+
+void AsyncWebServer::_nextSendRound(AsyncWebServerRequest *current) {
+  _sendRoundStart = millis();
+
+  std::vector<AsyncWebServerRequest *> resume;
+  for (SendFlow &flow : _sendFlows) {
+    if (flow.waiting) {
+      // backlogged: keep the unused deficit
+      flow.deficit += _sendQuantum[flow.priority];
+      flow.waiting = false;
+      if (flow.request != current) {
+        resume.push_back(flow.request);
+      }
+    } else {
+      // did not use its share (blocked by its connection): no credit accumulation
+      flow.deficit = _sendQuantum[flow.priority];
+    }
+  }
+
+  // resume the responses which were waiting for this round, highest priority first
+  // (the current one continues when returning from its grant)
+  std::stable_sort(resume.begin(), resume.end(), [this](AsyncWebServerRequest *a, AsyncWebServerRequest *b) {
+    SendFlow *fa = _findSendFlow(a);
+    SendFlow *fb = _findSendFlow(b);
+    return fa->priority < fb->priority;
+  });
+  _sendKicking = true;
+  for (AsyncWebServerRequest *r : resume) {
+    // a resumed response can complete and free its request
+    if (_findSendFlow(r)) {
+      r->_onPoll();
+    }
+  }
+  _sendKicking = false;
+}
+
+AsyncWebRouter *AsyncWebServer::_acquireRoutes() {
+  // called on the network task only: the current snapshot is only replaced here, so it cannot be released between load() and acquire()
+  if (_routesChanged.load(std::memory_order_acquire)) {
+    // the handlers and rewrites are usually all added before the server starts: they are indexed once, on the first request.
+    // If another task is changing them right now, the current snapshot is used until the next request instead of waiting.
+#ifdef ESP32
+    std::unique_lock<std::mutex> lock(_routesLock, std::try_to_lock);
+    if (!lock.owns_lock() && !_routes.load(std::memory_order_acquire)) {
+      lock.lock();
+    }
+    if (lock.owns_lock()) {
+      _routesChanged = false;
+      AsyncWebRouter *routes = new AsyncWebRouter(_handlers, _rewrites);
+      lock.unlock();
+#else
+    // single task: the handlers and rewrites cannot be changed meanwhile
+    {
+      _routesChanged = false;
+      AsyncWebRouter *routes = new AsyncWebRouter(_handlers, _rewrites);
+#endif
+      AsyncWebRouter *previous = _routes.exchange(routes, std::memory_order_acq_rel);
+      if (previous) {
+        // deleted with the last request routed with it
+        previous->release();
+      }
+    }
+  }
+  AsyncWebRouter *routes = _routes.load(std::memory_order_acquire);
+  routes->acquire();
+  return routes;
+}
+
 void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request) {
+  if (!request->_routes) {
+    request->_routes = _acquireRoutes();
+  }
   // the last rewrite that matches the request will be used
-  // we do not break the loop to allow for multiple rewrites to be applied and only the last one to be used (allows overriding)
-  for (const auto &r : _rewrites) {
-    if (r->match(request)) {
-      request->_url = r->toUrl();
-      request->_addGetParams(r->params());
-    }
+  // the rewrites after a match are still checked (against the new URL) to allow for multiple rewrites to be applied and only the last one to be used (allows overriding)
+  size_t next = 0;
+  while (AsyncWebRewrite *r = request->_routes->rewrite(request, next)) {
+    request->_url = r->toUrl();
+    request->_addGetParams(r->params());
   }
 }
 
 void AsyncWebServer::_attachHandler(AsyncWebServerRequest *request) {
-  for (auto &h : _handlers) {
-    if (h->filter(request) && h->canHandle(request)) {
-      request->setHandler(h.get());
-      return;
-    }
+  if (!request->_routes) {
+    request->_routes = _acquireRoutes();
+  }
+  AsyncWebHandler *handler = request->_routes->match(request);
+  if (handler) {
+    request->setHandler(handler);
+    return;
   }
   // ESP_LOGD("AsyncWebServer", "No handler found for %s, using _catchAllHandler pointer: %p", request->url().c_str(), _catchAllHandler);
   request->setHandler(_catchAllHandler);
@@ -169,6 +438,12 @@ AsyncStaticWebHandler &AsyncWebServer::serveStatic(const char *uri, fs::FS &fs,
   return *handler;
 }
 
+AsyncBundleWebHandler &AsyncWebServer::serveBundle(const char *uri, const AsyncBundle &bundle) {
+  AsyncBundleWebHandler *handler = new AsyncBundleWebHandler(uri, bundle);
+  addHandler(handler);
+  return *handler;
+}
+
 void AsyncWebServer::onNotFound(ArRequestHandlerFunction fn) {
   _catchAllHandler->onRequest(fn);
 }
@@ -186,8 +461,15 @@ AsyncWebHandler &AsyncWebServer::catchAllHandler() const {
 }
 
 void AsyncWebServer::reset() {
-  _rewrites.clear();
-  _handlers.clear();
+  {
+#ifdef ESP32
+    std::lock_guard<std::mutex> lock(_routesLock);
+#endif
+    _rewrites.clear();
+    _handlers.clear();
+    _routesChanged = true;
+  }
+  _sendFlows.clear();
 
   _catchAllHandler->onRequest(NULL);
   _catchAllHandler->onUpload(NULL);
@@ -11,6 +11,7 @@ static constexpr const char *T__opaque = "\", opaque=\"";
 static constexpr const char *T_100_CONTINUE = "100-continue";
 static constexpr const char *T_13 = "13";
 static constexpr const char *T_ACCEPT = "accept";
+static constexpr const char *T_Accept_Encoding = "accept-encoding";
 static constexpr const char *T_Accept_Ranges = "accept-ranges";
 static constexpr const char *T_app_xform_urlencoded = "application/x-www-form-urlencoded";
 static constexpr const char *T_AUTH = "authorization";
@@ -19,6 +20,8 @@ static constexpr const char *T_BASIC = "basic";
 static constexpr const char *T_BASIC_REALM = "basic realm=\"";
 static constexpr const char *T_BEARER = "bearer";
 static constexpr const char *T_BODY = "body";
+static constexpr const char *T_br = "br";
+static constexpr const char *T_bytes = "bytes";
 static constexpr const char *T_Cache_Control = "cache-control";
 static constexpr const char *T_chunked = "chunked";
 static constexpr const char *T_close = "close";
@@ -27,6 +30,7 @@ static constexpr const char *T_Connection = "connection";
 static constexpr const char *T_Content_Disposition = "content-disposition";
 static constexpr const char *T_Content_Encoding = "content-encoding";
 static constexpr const char *T_Content_Length = "content-length";
+static constexpr const char *T_Content_Range = "content-range";
 static constexpr const char *T_Content_Type = "content-type";
 static constexpr const char *T_Content_Location = "content-location";
 static constexpr const char *T_Cookie = "cookie";
@@ -46,25 +50,36 @@ static constexpr const char *T_EXPECT = "expect";
 static constexpr const char *T_FALSE = "false";
 static constexpr const char *T_filename = "filename";
 static constexpr const char *T_gzip = "gzip";
+static constexpr const char *T_identity = "identity";
 static constexpr const char *T_Host = "host";
 static constexpr const char *T_HTTP_1_0 = "HTTP/1.0";
 static constexpr const char *T_HTTP_100_CONT = "HTTP/1.1 100 Continue\r\n\r\n";
 static constexpr const char *T_id__ = "id: ";
 static constexpr const char *T_IMS = "if-modified-since";
 static constexpr const char *T_INM = "if-none-match";
+static constexpr const char *T_If_Match = "if-match";
+static constexpr const char *T_If_Range = "if-range";
+static constexpr const char *T_If_Unmodified_Since = "if-unmodified-since";
 static constexpr const char *T_keep_alive = "keep-alive";
 static constexpr const char *T_Last_Event_ID = "last-event-id";
 static constexpr const char *T_Last_Modified = "last-modified";
 static constexpr const char *T_LOCATION = "location";
 static constexpr const char *T_LOGIN_REQ = "Login Required";
+static constexpr const char *T_max_age_ = "max-age=";
 static constexpr const char *T_MULTIPART_ = "multipart/";
 static constexpr const char *T_name = "name";
 static constexpr const char *T_nc = "nc";
 static constexpr const char *T_no_cache = "no-cache";
+static constexpr const char *T_no_store = "no-store";
 static constexpr const char *T_nonce = "nonce";
 static constexpr const char *T_none = "none";
 static constexpr const char *T_opaque = "opaque";
+static constexpr const char *T_private = "private";
 static constexpr const char *T_qop = "qop";
+static constexpr const char *T_Range = "range";
+static constexpr const char *T_RateLimit_Limit = "ratelimit-limit";
+static constexpr const char *T_RateLimit_Remaining = "ratelimit-remaining";
+static constexpr const char *T_RateLimit_Reset = "ratelimit-reset";
 static constexpr const char *T_realm = "realm";
 static constexpr const char *T_realm__ = "realm=\"";
 static constexpr const char *T_response = "response";
@@ -73,14 +88,19 @@ static constexpr const char *T_retry_after = "retry-after";
 static constexpr const char *T_nn = "\n\n";
 static constexpr const char *T_rn = "\r\n";
 static constexpr const char *T_rnrn = "\r\n\r\n";
+static constexpr const char *T_Sec_WebSocket_Key = "sec-websocket-key";
+static constexpr const char *T_Sec_WebSocket_Protocol = "sec-websocket-protocol";
+static constexpr const char *T_Sec_WebSocket_Version = "sec-websocket-version";
 static constexpr const char *T_Server = "server";
 static constexpr const char *T_Transfer_Encoding = "transfer-encoding";
 static constexpr const char *T_TRUE = "true";
 static constexpr const char *T_UPGRADE = "upgrade";
 static constexpr const char *T_uri = "uri";
 static constexpr const char *T_username = "username";
+static constexpr const char *T_Vary = "vary";
 static constexpr const char *T_WS = "websocket";
 static constexpr const char *T_WWW_AUTH = "www-authenticate";
+static constexpr const char *T_x_gzip = "x-gzip";
 
 // HTTP Methods
 
@@ -103,6 +123,7 @@ static constexpr const char *T_RCT_EVENT = "RCT_EVENT";
 static constexpr const char *T_ERROR = "ERROR";
 
 // extensions & MIME-Types
+static constexpr const char *T__br = ".br";
 static constexpr const char *T__css = ".css";
 static constexpr const char *T__eot = ".eot";
 static constexpr const char *T__gif = ".gif";
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: LGPL-3.0-or-later
+# Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+"""
+Embed the files of a directory into a generated C++ header, to be served by AsyncBundleWebHandler:
+
+    #include "webbundle.h"
+    server.serveBundle("/", webBundle);
+
+Each file is stored in flash (gzip compressed when it is worth it) with its strong ETag, content type and cache policy.
+The compressed files are answered with 406 to the clients refusing gzip: use --no-gzip if such clients must be served.
+The paths are looked up through a perfect hash table computed at build time.
+
+Command line:
+
+    python3 tools/webbundle.py <directory> <output.h> [--name webBundle] [--cache-control "max-age=600"] [--no-gzip]
+
+PlatformIO (platformio.ini), the header is generated before each build:
+
+    extra_scripts = pre:<path to the library>/tools/webbundle.py
+    custom_webbundle_dir = data
+    custom_webbundle_output = src/webbundle.h
+    ; optional
+    custom_webbundle_name = webBundle
+    custom_webbundle_cache_control = no-cache
+
+CMake:
+
+    add_custom_command(
+      OUTPUT ${CMAKE_CURRENT_SOURCE_DIR}/webbundle.h
+      COMMAND python3 ${WEBBUNDLE_PY} ${CMAKE_CURRENT_SOURCE_DIR}/data ${CMAKE_CURRENT_SOURCE_DIR}/webbundle.h
+      DEPENDS ${WEBBUNDLE_PY} ${DATA_FILES})
+"""
+
+import argparse
+import gzip
+import mimetypes
+import os
+import re
+import sys
+
+FNV_PRIME = 16777619
+FNV_OFFSET_BASIS = 2166136261
+
+# content types of the files already compressed, gzip would not make them smaller
+COMPRESSED_TYPES = ("image/png", "image/jpeg", "image/gif", "image/webp", "font/woff", "font/woff2", "application/zip", "application/gzip")
+
+# same types as AsyncMimeTypes for the common web files
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".htm": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+    ".svg": "image/svg+xml",
+    ".jpg": "image/jpeg",
+    ".gif": "image/gif",
+    ".woff2": "font/woff2",
+    ".woff": "font/woff",
+    ".ttf": "font/ttf",
+    ".eot": "font/eot",
+    ".xml": "text/xml",
+    ".pdf": "application/pdf",
+    ".zip": "application/zip",
+    ".txt": "text/plain",
+    ".wasm": "application/wasm",
+}
+
+
+def fnv1a(data, seed=FNV_OFFSET_BASIS):
+    """Same hash as HashPrint::hash()"""
+    h = seed
+    for b in data:
+        h = ((h ^ b) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def content_type(path):
+    ext = os.path.splitext(path)[1].lower()
+    if ext in CONTENT_TYPES:
+        return CONTENT_TYPES[ext]
+    guessed, _ = mimetypes.guess_type(path)
+    return guessed or "application/octet-stream"
+
+
+def perfect_hash(paths):
+    """Find a seed for which the FNV-1a hashes of the paths do not collide in a power of 2 table"""
+    size = 1
+    while size < len(paths):
+        size *= 2
+    while True:
+        for seed in range(FNV_OFFSET_BASIS, FNV_OFFSET_BASIS + 20000):
+            slots = set()
+            for path in paths:
+                slot = fnv1a(path.encode(), seed) & (size - 1)
+                if slot in slots:
+                    break
+                slots.add(slot)
+            else:
+                return seed, size
+        size *= 2
+
+
+def c_string(value):
+    if value is None:
+        return "nullptr"
+    return '"' + value.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def generate(directory, output, name, cache_control, use_gzip):
+    assets = []
+    for root, dirs, files in os.walk(directory):
+        dirs.sort()
+        for filename in sorted(files):
+            full = os.path.join(root, filename)
+            path = "/" + os.path.relpath(full, directory).replace(os.sep, "/")
+            with open(full, "rb") as f:
+                data = f.read()
+            mime = content_type(path)
+            encoding = None
+            if use_gzip and mime not in COMPRESSED_TYPES:
+                compressed = gzip.compress(data, 9, mtime=0)
+                # only worth it if it saves at least 10%
+                if len(compressed) < len(data) * 0.9:
+                    data = compressed
+                    encoding = "gzip"
+            etag = '"%08x"' % fnv1a(data)
+            assets.append((path, data, etag, mime, encoding))
+
+    if len(assets) >= 0xFFFF:
+        sys.exit("webbundle: too many files")
+
+    seed, size = perfect_hash([a[0] for a in assets]) if assets else (FNV_OFFSET_BASIS, 0)
+    table = [0] * size
+    for i, asset in enumerate(assets):
+        table[fnv1a(asset[0].encode(), seed) & (size - 1)] = i + 1
+
+    ident = re.sub(r"\W", "_", name)
+    lines = [
+        "// Generated by tools/webbundle.py from %s, do not edit" % os.path.basename(os.path.abspath(directory)),
+        "#pragma once",
+        "",
+        "#include <ESPAsyncWebServer.h>",
+        "",
+    ]
+    for i, (path, data, etag, mime, encoding) in enumerate(assets):
+        lines.append("// %s (%d bytes%s)" % (path, len(data), ", " + encoding if encoding else ""))
+        lines.append("static const uint8_t %s_%d[] PROGMEM = {" % (ident, i))
+        for offset in range(0, len(data), 20):
+            lines.append("  " + ", ".join("0x%02x" % b for b in data[offset : offset + 20]) + ",")
+        lines.append("};")
+        lines.append("")
+
+    lines.append("static const AsyncBundleAsset %s_assets[] = {" % ident)
+    for i, (path, data, etag, mime, encoding) in enumerate(assets):
+        lines.append(
+            "  {%s, %s_%d, %d, %s, %s, %s, %s},"
+            % (c_string(path), ident, i, len(data), c_string(etag), c_string(mime), c_string(encoding), c_string(cache_control))
+        )
+    if not assets:
+        lines.append("  {nullptr, nullptr, 0, nullptr, nullptr, nullptr, nullptr},")
+    lines.append("};")
+    lines.append("")
+    lines.append("static const uint16_t %s_table[] = {%s};" % (ident, ", ".join(str(v) for v in table) if table else "0"))
+    lines.append("")
+    lines.append("static const AsyncBundle %s = {%s_assets, %d, %s_table, %d, 0x%08xUL};" % (ident, ident, len(assets), ident, size, seed))
+    lines.append("")
+
+    content = "\n".join(lines)
+    # do not touch the header if nothing changed, to avoid rebuilds
+    if os.path.exists(output):
+        with open(output, "r") as f:
+            if f.read() == content:
+                return
+    with open(output, "w") as f:
+        f.write(content)
+    print("webbundle: %d files embedded in %s" % (len(assets), output))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Embed a directory into a C++ header for AsyncBundleWebHandler")
+    parser.add_argument("directory")
+    parser.add_argument("output")
+    parser.add_argument("--name", default="webBundle", help="name of the AsyncBundle variable")
+    parser.add_argument("--cache-control", default=None, help="Cache-Control header of the files")
+    parser.add_argument("--no-gzip", action="store_true", help="do not compress the files")
+    args = parser.parse_args()
+    generate(args.directory, args.output, args.name, args.cache_control, not args.no_gzip)
+
+
+try:
+    Import("env")  # noqa: F821 - PlatformIO extra script
+except NameError:
+    if __name__ == "__main__":
+        main()
+else:
+    project_dir = env["PROJECT_DIR"]  # noqa: F821
+    option = env.GetProjectOption  # noqa: F821
+    directory = option("custom_webbundle_dir", "data")
+    output = option("custom_webbundle_output", os.path.join("src", "webbundle.h"))
+    generate(
+        os.path.join(project_dir, directory),
+        os.path.join(project_dir, output),
+        option("custom_webbundle_name", "webBundle"),
+        option("custom_webbundle_cache_control", None),
+        option("custom_webbundle_gzip", "yes") != "no",
+    )